@@ -0,0 +1,89 @@
+// Parse, semantic analysis and IR generation times on one input.
+// usage: cyrexc-bench-frontend [file.cyrex] [iterations] [threads]
+#include "frontend/source.hpp"
+#include "frontend/lexicon.hpp"
+#include "frontend/parse-parallel.hpp"
+#include "frontend/semantics.hpp"
+#include "backend/irgen.hpp"
+#include "generate.hpp"
+
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <string>
+#include <optional>
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+using Clock = chrono::steady_clock;
+
+static double seconds(const Clock::time_point begin, const Clock::time_point end) {
+	return chrono::duration<double>(end - begin).count();
+}
+
+int main(int argc, const char* argv[]) {
+	optional<SourceBuffer> file;
+	string generated;
+	string_view src;
+
+	if (argc > 1 && *argv[1]) {
+		file.emplace(argv[1]);
+		src = file->text();
+	} else {
+		generated = generate_source(16 << 20);
+		src = generated;
+	}
+	const int iterations = argc > 2 ? stoi(argv[2]) : 5;
+	const unsigned threads = argc > 3 ? stoi(argv[3]) : max(1u, thread::hardware_concurrency());
+	const double megabytes = src.size() / (1024.0 * 1024.0);
+
+	cout << format("input: {} bytes, {} iterations, {} threads\n", src.size(), iterations, threads);
+
+	// reused between iterations the same way cyrexc reuses it between files
+	AST::Root root;
+	double best_parse = 1e30, best_sema = 1e30, best_irgen = 1e30;
+	size_t num_nodes = 0;
+
+	for (int i = 0; i < iterations; ++i) {
+		Interner interner;
+		Diagnostics diagnostics;
+		const auto t0 = Clock::now();
+		parse_parallel(src, keywords, punctuation_trie, interner, diagnostics, root, threads);
+		const auto t1 = Clock::now();
+		if (diagnostics.has_errors()) {
+			cerr << format("input has {} errors\n", diagnostics.get().size());
+			return EXIT_FAILURE;
+		}
+
+		SemanticAnalyzer sa{ interner, diagnostics };
+		sa.analyze(root);
+		const auto t2 = Clock::now();
+		if (diagnostics.has_errors()) {
+			cerr << format("input has {} semantic errors\n", diagnostics.get().size());
+			return EXIT_FAILURE;
+		}
+
+		IRGen irgen{ interner };
+		irgen.gen(root);
+		const auto t3 = Clock::now();
+
+		best_parse = min(best_parse, seconds(t0, t1));
+		best_sema = min(best_sema, seconds(t1, t2));
+		best_irgen = min(best_irgen, seconds(t2, t3));
+
+		num_nodes = 0;
+		for (const auto& function : root.functions) {
+			num_nodes += function.size();
+		}
+	}
+
+	cout << format("{} functions, {} nodes\n", root.functions.size(), num_nodes);
+	cout << format("   parse: {:8.2f} ms {:8.1f} MB/s\n", best_parse * 1e3, megabytes / best_parse);
+	cout << format("    sema: {:8.2f} ms\n", best_sema * 1e3);
+	cout << format("   irgen: {:8.2f} ms\n", best_irgen * 1e3);
+	const double total = best_parse + best_sema + best_irgen;
+	cout << format("   total: {:8.2f} ms {:8.1f} MB/s\n", total * 1e3, megabytes / total);
+	return 0;
+}
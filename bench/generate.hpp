@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <format>
+
+// identifiers have no digits, so numbers are spelled with letters
+inline std::string letters(std::size_t n) {
+	std::string s;
+	do {
+		s += static_cast<char>('a' + n % 26);
+		n /= 26;
+	} while (n);
+	return s;
+}
+
+// identifier, number and operator heavy code, similar to what generators emit
+inline std::string generate_source(const std::size_t target_size) {
+	std::string src;
+	src.reserve(target_size + 256);
+	for (std::size_t fn = 0; src.size() < target_size; ++fn) {
+		src += std::format("function generated_function_{}() : int {{\n", letters(fn));
+		src += std::format("\tvar argument_value : int = {}\n", fn % 1000);
+		src += "\tvar accumulator_value : int = 0\n";
+		for (int i = 0; i < 32; ++i) {
+			src += std::format("\taccumulator_value = accumulator_value + argument_value - {} <= {}\n", i * 7919, i);
+			src += "\tif accumulator_value >= 1000000 do accumulator_value = accumulator_value - 1000000\n";
+		}
+		src += "\treturn accumulator_value\n}\n\n";
+	}
+	return src;
+}
@@ -0,0 +1,84 @@
+// Keyword classification: the compile time perfect hash against std::map.
+// usage: cyrexc-bench-keywords [iterations]
+#include "frontend/lexicon.hpp"
+
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <string>
+#include <map>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+// mostly identifiers, some of which look almost like keywords
+static vector<string> generate_words(const size_t count) {
+	const vector<string> stems = {
+		"value", "index", "accumulator", "result", "tmp", "x", "y", "in", "i",
+		"functions", "returned", "whiles", "iff", "thenx", "elsewhere", "constant",
+		"variable", "inlined", "done", "voids", "chars", "shortest", "integer", "longer",
+	};
+
+	mt19937 rng(1234);
+	vector<string> words;
+	words.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		// one in eight words is a real keyword
+		if (rng() % 8 == 0) {
+			words.emplace_back(keyword_spellings[rng() % keyword_spellings.size()].text);
+		} else {
+			words.push_back(stems[rng() % stems.size()] + (rng() % 2 ? to_string(rng() % 100) : ""));
+		}
+	}
+	return words;
+}
+
+template <typename Classify>
+static double time_best(const vector<string_view>& words, const int iterations, size_t& num_keywords, Classify&& classify) {
+	double best_seconds = 1e30;
+	for (int i = 0; i < iterations; ++i) {
+		size_t found = 0;
+		const auto begin = chrono::steady_clock::now();
+		for (const auto word : words) {
+			found += classify(word) != Token::Type::Identifier;
+		}
+		const auto end = chrono::steady_clock::now();
+		best_seconds = min(best_seconds, chrono::duration<double>(end - begin).count());
+		num_keywords = found;
+	}
+	return best_seconds;
+}
+
+int main(int argc, const char* argv[]) {
+	const int iterations = argc > 1 ? stoi(argv[1]) : 10;
+	const auto storage = generate_words(4'000'000);
+	const vector<string_view> words(storage.begin(), storage.end());
+
+	// what the lexer used before the perfect hash
+	map<string, Token::Type, less<>> keyword_map;
+	for (const auto& [text, type] : keyword_spellings) {
+		keyword_map.emplace(text, type);
+	}
+
+	size_t map_keywords = 0;
+	const double map_seconds = time_best(words, iterations, map_keywords, [&](string_view word) {
+		if (auto it = keyword_map.find(word); it != keyword_map.end()) return it->second;
+		return Token::Type::Identifier;
+	});
+
+	size_t table_keywords = 0;
+	const double table_seconds = time_best(words, iterations, table_keywords, [&](string_view word) {
+		return keywords.find(word).value_or(Token::Type::Identifier);
+	});
+
+	if (map_keywords != table_keywords) {
+		cerr << format("keyword counts differ: map {}, perfect hash {}\n", map_keywords, table_keywords);
+		return EXIT_FAILURE;
+	}
+
+	cout << format("{} words, {} keywords, {} iterations\n", words.size(), table_keywords, iterations);
+	cout << format("     std::map: {:.2f} ns/word\n", map_seconds * 1e9 / words.size());
+	cout << format(" perfect hash: {:.2f} ns/word\n", table_seconds * 1e9 / words.size());
+	return 0;
+}
@@ -0,0 +1,63 @@
+// Lexer throughput for every character scanner the cpu supports.
+// usage: cyrexc-bench-lexer [file.cyrex] [iterations]
+#include "frontend/source.hpp"
+#include "frontend/lexicon.hpp"
+#include "generate.hpp"
+
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <string>
+#include <optional>
+#include <algorithm>
+
+using namespace std;
+
+int main(int argc, const char* argv[]) {
+	optional<SourceBuffer> file;
+	string generated;
+	string_view src;
+
+	if (argc > 1) {
+		file.emplace(argv[1]);
+		src = file->text();
+	} else {
+		generated = generate_source(16 << 20);
+		src = generated;
+	}
+	const int iterations = argc > 2 ? stoi(argv[2]) : 10;
+	const double megabytes = src.size() / (1024.0 * 1024.0);
+
+	cout << format("input: {} bytes, {} iterations\n", src.size(), iterations);
+
+	size_t expected_tokens = 0;
+	for (const auto isa : { Isa::Scalar, Isa::SSE2, Isa::AVX2 }) {
+		const Scanner* scanner = Scanner::get(isa);
+		if (!scanner) {
+			cout << format("{:>8}: not supported\n", isa_name(isa));
+			continue;
+		}
+
+		double best_seconds = 1e30;
+		size_t num_tokens = 0;
+		for (int i = 0; i < iterations; ++i) {
+			Interner interner;
+			Diagnostics diagnostics;
+			const auto begin = chrono::steady_clock::now();
+			const auto tokens = tokenize(src, keywords, punctuation_trie, interner, diagnostics, *scanner);
+			const auto end = chrono::steady_clock::now();
+			best_seconds = min(best_seconds, chrono::duration<double>(end - begin).count());
+			num_tokens = tokens.size();
+		}
+
+		if (expected_tokens == 0) expected_tokens = num_tokens;
+		if (num_tokens != expected_tokens) {
+			cerr << format("{} produced {} tokens, expected {}\n", isa_name(isa), num_tokens, expected_tokens);
+			return EXIT_FAILURE;
+		}
+
+		cout << format("{:>8}: {:.1f} MB/s ({} tokens)\n", isa_name(isa), megabytes / best_seconds, num_tokens);
+	}
+
+	return 0;
+}
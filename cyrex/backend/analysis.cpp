@@ -0,0 +1,312 @@
+#include "analysis.hpp"
+#include <algorithm>
+
+CFGOrder compute_cfg_order(const CFGFunction& fn) {
+	const auto num_blocks = fn.blocks.size();
+	CFGOrder order;
+	order.rpo.reserve(num_blocks);
+	order.rpo_index.assign(num_blocks, NoBlock);
+	if (!num_blocks) return order;
+
+	// iterative depth first search, every entry is a block and its next successor to visit
+	std::vector<std::pair<BlockId, std::uint32_t>> stack;
+	std::vector<bool> visited(num_blocks);
+	stack.push_back({ 0, 0 });
+	visited[0] = true;
+	while (!stack.empty()) {
+		auto& [block, next] = stack.back();
+		const auto& successors = fn.blocks[block].successors;
+		if (next < successors.size()) {
+			const BlockId succ = successors[next++];
+			if (!visited[succ]) {
+				visited[succ] = true;
+				stack.push_back({ succ, 0 });
+			}
+			continue;
+		}
+		order.rpo.push_back(block);
+		stack.pop_back();
+	}
+
+	std::reverse(order.rpo.begin(), order.rpo.end());
+	for (BlockId i = 0; i < order.rpo.size(); ++i) {
+		order.rpo_index[order.rpo[i]] = i;
+	}
+	return order;
+}
+
+DominatorTree compute_dominators(const CFGFunction& fn, const CFGOrder& order) {
+	const auto num_blocks = fn.blocks.size();
+	const auto& rpo = order.rpo;
+	DominatorTree tree;
+	tree.idom.assign(num_blocks, NoBlock);
+	tree.child_begin.assign(num_blocks + 1, 0);
+	tree.preorder.assign(num_blocks, NoBlock);
+	tree.subtree_size.assign(num_blocks, 0);
+	if (rpo.empty()) return tree;
+
+	// immediate dominators as rpo indices, so the walk up to a common dominator compares numbers
+	std::vector<BlockId> doms(rpo.size(), NoBlock);
+	doms[0] = 0;
+	const auto intersect = [&](BlockId a, BlockId b) {
+		while (a != b) {
+			while (a > b) a = doms[a];
+			while (b > a) b = doms[b];
+		}
+		return a;
+	};
+	for (bool changed = true; changed;) {
+		changed = false;
+		for (BlockId i = 1; i < rpo.size(); ++i) {
+			BlockId new_idom = NoBlock;
+			for (const auto pred : fn.blocks[rpo[i]].predecessors) {
+				const auto p = order.rpo_index[pred];
+				// unreachable, or not processed yet
+				if (p == NoBlock || doms[p] == NoBlock) continue;
+				new_idom = new_idom == NoBlock ? p : intersect(p, new_idom);
+			}
+			if (doms[i] != new_idom) {
+				doms[i] = new_idom;
+				changed = true;
+			}
+		}
+	}
+
+	for (BlockId i = 1; i < rpo.size(); ++i) {
+		tree.idom[rpo[i]] = rpo[doms[i]];
+		++tree.child_begin[rpo[doms[i]] + 1];
+	}
+	for (std::size_t b = 0; b < num_blocks; ++b) {
+		tree.child_begin[b + 1] += tree.child_begin[b];
+	}
+	tree.child_list.resize(rpo.size() - 1);
+	auto next_child = tree.child_begin;
+	for (BlockId i = 1; i < rpo.size(); ++i) {
+		tree.child_list[next_child[tree.idom[rpo[i]]]++] = rpo[i];
+	}
+
+	// a dominator comes before the blocks it dominates in reverse postorder,
+	// so subtree sizes add up backwards and preorder numbers are handed out forwards
+	for (auto i = rpo.size(); i-- > 0;) {
+		const auto block = rpo[i];
+		tree.subtree_size[block] += 1;
+		if (i) tree.subtree_size[tree.idom[block]] += tree.subtree_size[block];
+	}
+	tree.preorder[rpo[0]] = 0;
+	for (const auto block : rpo) {
+		auto next = tree.preorder[block] + 1;
+		for (const auto child : tree.children(block)) {
+			tree.preorder[child] = next;
+			next += tree.subtree_size[child];
+		}
+	}
+	return tree;
+}
+
+DominanceFrontiers compute_dominance_frontiers(const CFGFunction& fn, const CFGOrder& order, const DominatorTree& dominators) {
+	DominanceFrontiers df;
+	df.frontiers.resize(fn.blocks.size());
+	for (const auto block : order.rpo) {
+		const auto& preds = fn.blocks[block].predecessors;
+		if (preds.size() < 2) continue;
+		// every predecessor up to the immediate dominator of a join has the join in its frontier
+		for (const auto pred : preds) {
+			if (!order.is_reachable(pred)) continue;
+			for (auto runner = pred; runner != NoBlock && runner != dominators.idom[block]; runner = dominators.idom[runner]) {
+				auto& frontier = df.frontiers[runner];
+				// joins are visited one at a time, so a repeat is always the last one added
+				if (!frontier.empty() && frontier.back() == block) break;
+				frontier.push_back(block);
+			}
+		}
+	}
+	return df;
+}
+
+LoopForest compute_loops(const CFGFunction& fn, const CFGOrder& order, const DominatorTree& dominators) {
+	const auto num_blocks = fn.blocks.size();
+	LoopForest forest;
+	forest.block_loop.assign(num_blocks, NoLoop);
+	auto& loops = forest.loops;
+
+	// a back edge goes to a block that dominates its source. Headers are
+	// found in reverse postorder, so outer loops get the lower ids
+	for (const auto block : order.rpo) {
+		Loop loop{ .header = block };
+		for (const auto pred : fn.blocks[block].predecessors) {
+			if (dominators.dominates(block, pred)) loop.latches.push_back(pred);
+		}
+		if (loop.latches.empty()) continue;
+		forest.block_loop[block] = static_cast<LoopId>(loops.size());
+		loops.push_back(std::move(loop));
+	}
+
+	// inner loops first: walk backwards from the latches to the header, an
+	// inner loop met on the way is skipped over by going to its header.
+	// outermost[] finds the outermost loop found so far, with path halving
+	std::vector<LoopId> outermost(loops.size());
+	for (LoopId id = 0; id < loops.size(); ++id) outermost[id] = id;
+	const auto find_outermost = [&](LoopId id) {
+		while (outermost[id] != id) {
+			outermost[id] = outermost[outermost[id]];
+			id = outermost[id];
+		}
+		return id;
+	};
+	std::vector<BlockId> worklist;
+	for (auto id = static_cast<LoopId>(loops.size()); id-- > 0;) {
+		worklist.assign(loops[id].latches.begin(), loops[id].latches.end());
+		while (!worklist.empty()) {
+			auto block = worklist.back();
+			worklist.pop_back();
+			if (!order.is_reachable(block)) continue;
+			if (forest.block_loop[block] == NoLoop) {
+				forest.block_loop[block] = id;
+			} else {
+				const auto inner = find_outermost(forest.block_loop[block]);
+				if (inner == id) continue;
+				loops[inner].parent = id;
+				outermost[inner] = id;
+				block = loops[inner].header;
+			}
+			const auto& preds = fn.blocks[block].predecessors;
+			worklist.insert(worklist.end(), preds.begin(), preds.end());
+		}
+	}
+
+	for (LoopId id = 0; id < loops.size(); ++id) {
+		auto& loop = loops[id];
+		if (loop.parent == NoLoop) {
+			loop.depth = 1;
+			forest.top_level.push_back(id);
+		} else {
+			loop.depth = loops[loop.parent].depth + 1;
+			loops[loop.parent].children.push_back(id);
+		}
+	}
+
+	// lay the loops out in preorder, every loop takes its own blocks and then the ranges of its children
+	for (const auto block : order.rpo) {
+		if (forest.block_loop[block] != NoLoop) ++loops[forest.block_loop[block]].num_blocks;
+	}
+	std::vector<std::uint32_t> next_block(loops.size());
+	for (LoopId id = 0; id < loops.size(); ++id) next_block[id] = loops[id].num_blocks;
+	for (auto id = static_cast<LoopId>(loops.size()); id-- > 0;) {
+		if (loops[id].parent != NoLoop) loops[loops[id].parent].num_blocks += loops[id].num_blocks;
+	}
+	std::uint32_t num_loop_blocks = 0;
+	for (LoopId id = 0; id < loops.size(); ++id) {
+		auto& loop = loops[id];
+		if (loop.parent == NoLoop) {
+			loop.first_block = num_loop_blocks;
+			num_loop_blocks += loop.num_blocks;
+		}
+		// next_block held the number of the loop's own blocks
+		auto next = loop.first_block + next_block[id];
+		for (const auto child : loop.children) {
+			loops[child].first_block = next;
+			next += loops[child].num_blocks;
+		}
+		next_block[id] = loop.first_block;
+	}
+	forest.loop_blocks.resize(num_loop_blocks);
+	forest.block_index.assign(num_blocks, NoBlock);
+
+	const auto depth = [&](const LoopId id) { return id == NoLoop ? 0 : loops[id].depth; };
+	for (const auto block : order.rpo) {
+		const auto innermost = forest.block_loop[block];
+		if (innermost != NoLoop) {
+			forest.block_index[block] = next_block[innermost];
+			forest.loop_blocks[next_block[innermost]++] = block;
+		}
+		// an edge leaves every loop up to the innermost one holding both ends
+		for (const auto succ : fn.blocks[block].successors) {
+			auto from = innermost;
+			auto to = forest.block_loop[succ];
+			while (from != to) {
+				if (depth(from) >= depth(to)) {
+					loops[from].exits.push_back(succ);
+					from = loops[from].parent;
+				} else {
+					to = loops[to].parent;
+				}
+			}
+		}
+	}
+
+	for (auto& loop : loops) {
+		std::sort(loop.exits.begin(), loop.exits.end(), [&](const BlockId a, const BlockId b) {
+			return order.rpo_index[a] < order.rpo_index[b];
+		});
+		loop.exits.erase(std::unique(loop.exits.begin(), loop.exits.end()), loop.exits.end());
+
+		// the header dominates every block of its loop, so the others enter it
+		BlockId entering = NoBlock;
+		std::size_t num_entering = 0;
+		for (const auto pred : fn.blocks[loop.header].predecessors) {
+			if (!order.is_reachable(pred) || dominators.dominates(loop.header, pred)) continue;
+			entering = pred;
+			++num_entering;
+		}
+		if (num_entering == 1 && fn.blocks[entering].successors.size() == 1) {
+			loop.preheader = entering;
+		}
+	}
+	return forest;
+}
+
+const CFGOrder& FunctionAnalyses::cfg_order() {
+	if (!order) order = compute_cfg_order(fn);
+	return *order;
+}
+
+const DominatorTree& FunctionAnalyses::dominators() {
+	if (!dominator_tree) dominator_tree = compute_dominators(fn, cfg_order());
+	return *dominator_tree;
+}
+
+const DominanceFrontiers& FunctionAnalyses::dominance_frontiers() {
+	if (!frontiers) frontiers = compute_dominance_frontiers(fn, cfg_order(), dominators());
+	return *frontiers;
+}
+
+const LoopForest& FunctionAnalyses::loops() {
+	if (!loop_forest) loop_forest = compute_loops(fn, cfg_order(), dominators());
+	return *loop_forest;
+}
+
+const Liveness& FunctionAnalyses::liveness() {
+	if (!live_values) live_values = compute_liveness(fn, cfg_order().rpo);
+	return *live_values;
+}
+
+const ReachingDefinitions& FunctionAnalyses::reaching_definitions() {
+	if (!reaching) reaching = compute_reaching_definitions(fn, cfg_order().rpo);
+	return *reaching;
+}
+
+const AvailableExpressions& FunctionAnalyses::available_expressions() {
+	if (!available) available = compute_available_expressions(fn, cfg_order().rpo);
+	return *available;
+}
+
+void FunctionAnalyses::require(const AnalysisSet analyses) {
+	if (analyses & analysis_set(Analysis::CFGOrder)) cfg_order();
+	if (analyses & analysis_set(Analysis::Dominators)) dominators();
+	if (analyses & analysis_set(Analysis::DominanceFrontiers)) dominance_frontiers();
+	if (analyses & analysis_set(Analysis::Loops)) loops();
+	if (analyses & analysis_set(Analysis::Liveness)) liveness();
+	if (analyses & analysis_set(Analysis::ReachingDefinitions)) reaching_definitions();
+	if (analyses & analysis_set(Analysis::AvailableExpressions)) available_expressions();
+}
+
+void FunctionAnalyses::invalidate(const AnalysisSet preserved) {
+	// an analysis is only kept while the analyses it was computed from are
+	if (!(preserved & analysis_set(Analysis::CFGOrder))) order.reset();
+	if (!order || !(preserved & analysis_set(Analysis::Dominators))) dominator_tree.reset();
+	if (!dominator_tree || !(preserved & analysis_set(Analysis::DominanceFrontiers))) frontiers.reset();
+	if (!dominator_tree || !(preserved & analysis_set(Analysis::Loops))) loop_forest.reset();
+	if (!order || !(preserved & analysis_set(Analysis::Liveness))) live_values.reset();
+	if (!order || !(preserved & analysis_set(Analysis::ReachingDefinitions))) reaching.reset();
+	if (!order || !(preserved & analysis_set(Analysis::AvailableExpressions))) available.reset();
+}
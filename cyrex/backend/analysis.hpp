@@ -0,0 +1,147 @@
+#pragma once
+#include "ir.hpp"
+#include "pass-manager.hpp"
+#include "dataflow.hpp"
+#include <optional>
+#include <span>
+
+enum class Analysis : std::uint8_t {
+	CFGOrder,
+	Dominators,
+	DominanceFrontiers,
+	Loops,
+	Liveness,
+	ReachingDefinitions,
+	AvailableExpressions,
+};
+
+constexpr AnalysisSet analysis_set(const Analysis analysis) {
+	return AnalysisSet{ 1 } << static_cast<int>(analysis);
+}
+
+// Blocks reachable from the entry, in reverse postorder
+struct CFGOrder {
+	std::vector<BlockId> rpo;
+	// position of every block in rpo, NoBlock for unreachable blocks
+	std::vector<BlockId> rpo_index;
+
+	bool is_reachable(const BlockId block) const { return rpo_index[block] != NoBlock; }
+};
+
+CFGOrder compute_cfg_order(const CFGFunction& fn);
+
+// The immediate dominators of the reachable blocks, as a tree rooted at the entry
+struct DominatorTree {
+	// NoBlock for the entry and unreachable blocks
+	std::vector<BlockId> idom;
+	// the children of block b are child_list[child_begin[b]..child_begin[b + 1]], in reverse postorder
+	std::vector<std::uint32_t> child_begin;
+	std::vector<BlockId> child_list;
+	// preorder number of every block in the tree and the size of its subtree,
+	// NoBlock for unreachable blocks, so dominance is a range check
+	std::vector<std::uint32_t> preorder;
+	std::vector<std::uint32_t> subtree_size;
+
+	std::span<const BlockId> children(const BlockId block) const {
+		return std::span(child_list).subspan(child_begin[block], child_begin[block + 1] - child_begin[block]);
+	}
+
+	// whether every path from the entry to b passes a, blocks dominate themselves
+	bool dominates(const BlockId a, const BlockId b) const {
+		if (preorder[a] == NoBlock || preorder[b] == NoBlock) return false;
+		return preorder[a] <= preorder[b] && preorder[b] < preorder[a] + subtree_size[a];
+	}
+};
+
+// Cooper, Harvey and Kennedy's iterative algorithm over reverse postorder
+DominatorTree compute_dominators(const CFGFunction& fn, const CFGOrder& order);
+
+// The blocks where the dominance of every block ends
+struct DominanceFrontiers {
+	std::vector<std::vector<BlockId>> frontiers;
+
+	std::span<const BlockId> frontier(const BlockId block) const { return frontiers[block]; }
+};
+
+DominanceFrontiers compute_dominance_frontiers(const CFGFunction& fn, const CFGOrder& order, const DominatorTree& dominators);
+
+// Index of a loop within its function
+using LoopId = std::uint32_t;
+constexpr static LoopId NoLoop = ~LoopId{};
+
+struct Loop {
+	BlockId header{};
+	LoopId parent = NoLoop;
+	// 1 for loops that are not nested in another
+	std::uint32_t depth{};
+	// range of LoopForest::loop_blocks with the blocks of the loop and its inner loops
+	std::uint32_t first_block{};
+	std::uint32_t num_blocks{};
+	// blocks of the loop that jump back to the header
+	std::vector<BlockId> latches;
+	// blocks outside of the loop that blocks of the loop jump to, in reverse postorder
+	std::vector<BlockId> exits;
+	// the only block entering the loop, if it jumps nowhere else
+	BlockId preheader = NoBlock;
+	std::vector<LoopId> children;
+};
+
+// The natural loops of a function. A cycle entered at more than one
+// block is irreducible, it has no header and is not a loop.
+struct LoopForest {
+	// outer loops come before the loops nested in them
+	std::vector<Loop> loops;
+	// innermost loop of every block, NoLoop outside of loops
+	std::vector<LoopId> block_loop;
+	std::vector<LoopId> top_level;
+	// every block in a loop once, the range of a loop holds the ranges of
+	// its inner loops after its own blocks, which start with the header
+	std::vector<BlockId> loop_blocks;
+	// position of every block in loop_blocks, NoBlock outside of loops
+	std::vector<std::uint32_t> block_index;
+
+	std::span<const BlockId> blocks(const LoopId loop) const {
+		return std::span(loop_blocks).subspan(loops[loop].first_block, loops[loop].num_blocks);
+	}
+
+	std::uint32_t depth(const BlockId block) const {
+		return block_loop[block] == NoLoop ? 0 : loops[block_loop[block]].depth;
+	}
+
+	bool contains(const LoopId loop, const BlockId block) const {
+		const auto index = block_index[block];
+		return index != NoBlock && index - loops[loop].first_block < loops[loop].num_blocks;
+	}
+};
+
+LoopForest compute_loops(const CFGFunction& fn, const CFGOrder& order, const DominatorTree& dominators);
+
+// The analyses of one function, computed when first asked for and kept
+// until a pass that does not preserve them changes the function.
+class FunctionAnalyses {
+public:
+	explicit FunctionAnalyses(const CFGFunction& fn) : fn(fn) {}
+
+	const CFGOrder& cfg_order();
+	const DominatorTree& dominators();
+	const DominanceFrontiers& dominance_frontiers();
+	const LoopForest& loops();
+	const Liveness& liveness();
+	const ReachingDefinitions& reaching_definitions();
+	const AvailableExpressions& available_expressions();
+
+	void require(const AnalysisSet analyses);
+	void invalidate(const AnalysisSet preserved);
+
+private:
+	const CFGFunction& fn;
+	std::optional<CFGOrder> order;
+	std::optional<DominatorTree> dominator_tree;
+	std::optional<DominanceFrontiers> frontiers;
+	std::optional<LoopForest> loop_forest;
+	std::optional<Liveness> live_values;
+	std::optional<ReachingDefinitions> reaching;
+	std::optional<AvailableExpressions> available;
+};
+
+using FunctionPassManager = PassManager<CFGFunction, FunctionAnalyses>;
@@ -0,0 +1,248 @@
+#include "bitset.hpp"
+#include <algorithm>
+
+#ifdef CYREX_X64
+#include <immintrin.h>
+#endif
+
+using Word = BitSetKernels::Word;
+
+// -- scalar --
+// the simd kernels finish their last words with these
+
+static bool unite_scalar(Word* dst, const Word* src, const std::size_t n) {
+	Word changed = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const Word word = dst[i] | src[i];
+		changed |= word ^ dst[i];
+		dst[i] = word;
+	}
+	return changed;
+}
+
+static bool intersect_scalar(Word* dst, const Word* src, const std::size_t n) {
+	Word changed = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const Word word = dst[i] & src[i];
+		changed |= word ^ dst[i];
+		dst[i] = word;
+	}
+	return changed;
+}
+
+static bool subtract_scalar(Word* dst, const Word* src, const std::size_t n) {
+	Word changed = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const Word word = dst[i] & ~src[i];
+		changed |= word ^ dst[i];
+		dst[i] = word;
+	}
+	return changed;
+}
+
+static bool transfer_scalar(Word* dst, const Word* gen, const Word* in, const Word* kill, const std::size_t n) {
+	Word changed = 0;
+	for (std::size_t i = 0; i < n; ++i) {
+		const Word word = gen[i] | (in[i] & ~kill[i]);
+		changed |= word ^ dst[i];
+		dst[i] = word;
+	}
+	return changed;
+}
+
+#ifdef CYREX_X64
+
+// -- sse2 --
+
+static __m128i sse2_load(const Word* words) {
+	return _mm_loadu_si128(reinterpret_cast<const __m128i*>(words));
+}
+
+static void sse2_store(Word* words, const __m128i vector) {
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(words), vector);
+}
+
+static bool sse2_any(const __m128i vector) {
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(vector, _mm_setzero_si128())) != 0xffff;
+}
+
+static bool unite_sse2(Word* dst, const Word* src, const std::size_t n) {
+	__m128i changed = _mm_setzero_si128();
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		const __m128i old = sse2_load(dst + i);
+		const __m128i word = _mm_or_si128(old, sse2_load(src + i));
+		changed = _mm_or_si128(changed, _mm_xor_si128(word, old));
+		sse2_store(dst + i, word);
+	}
+	return unite_scalar(dst + i, src + i, n - i) | sse2_any(changed);
+}
+
+static bool intersect_sse2(Word* dst, const Word* src, const std::size_t n) {
+	__m128i changed = _mm_setzero_si128();
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		const __m128i old = sse2_load(dst + i);
+		const __m128i word = _mm_and_si128(old, sse2_load(src + i));
+		changed = _mm_or_si128(changed, _mm_xor_si128(word, old));
+		sse2_store(dst + i, word);
+	}
+	return intersect_scalar(dst + i, src + i, n - i) | sse2_any(changed);
+}
+
+static bool subtract_sse2(Word* dst, const Word* src, const std::size_t n) {
+	__m128i changed = _mm_setzero_si128();
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		const __m128i old = sse2_load(dst + i);
+		// andnot clears the bits of its first operand
+		const __m128i word = _mm_andnot_si128(sse2_load(src + i), old);
+		changed = _mm_or_si128(changed, _mm_xor_si128(word, old));
+		sse2_store(dst + i, word);
+	}
+	return subtract_scalar(dst + i, src + i, n - i) | sse2_any(changed);
+}
+
+static bool transfer_sse2(Word* dst, const Word* gen, const Word* in, const Word* kill, const std::size_t n) {
+	__m128i changed = _mm_setzero_si128();
+	std::size_t i = 0;
+	for (; i + 2 <= n; i += 2) {
+		const __m128i word = _mm_or_si128(sse2_load(gen + i), _mm_andnot_si128(sse2_load(kill + i), sse2_load(in + i)));
+		changed = _mm_or_si128(changed, _mm_xor_si128(word, sse2_load(dst + i)));
+		sse2_store(dst + i, word);
+	}
+	return transfer_scalar(dst + i, gen + i, in + i, kill + i, n - i) | sse2_any(changed);
+}
+
+// -- avx2 --
+
+CYREX_TARGET_AVX2 static __m256i avx2_load(const Word* words) {
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words));
+}
+
+CYREX_TARGET_AVX2 static void avx2_store(Word* words, const __m256i vector) {
+	_mm256_storeu_si256(reinterpret_cast<__m256i*>(words), vector);
+}
+
+CYREX_TARGET_AVX2 static bool unite_avx2(Word* dst, const Word* src, const std::size_t n) {
+	__m256i changed = _mm256_setzero_si256();
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m256i old = avx2_load(dst + i);
+		const __m256i word = _mm256_or_si256(old, avx2_load(src + i));
+		changed = _mm256_or_si256(changed, _mm256_xor_si256(word, old));
+		avx2_store(dst + i, word);
+	}
+	return unite_scalar(dst + i, src + i, n - i) | !_mm256_testz_si256(changed, changed);
+}
+
+CYREX_TARGET_AVX2 static bool intersect_avx2(Word* dst, const Word* src, const std::size_t n) {
+	__m256i changed = _mm256_setzero_si256();
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m256i old = avx2_load(dst + i);
+		const __m256i word = _mm256_and_si256(old, avx2_load(src + i));
+		changed = _mm256_or_si256(changed, _mm256_xor_si256(word, old));
+		avx2_store(dst + i, word);
+	}
+	return intersect_scalar(dst + i, src + i, n - i) | !_mm256_testz_si256(changed, changed);
+}
+
+CYREX_TARGET_AVX2 static bool subtract_avx2(Word* dst, const Word* src, const std::size_t n) {
+	__m256i changed = _mm256_setzero_si256();
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m256i old = avx2_load(dst + i);
+		const __m256i word = _mm256_andnot_si256(avx2_load(src + i), old);
+		changed = _mm256_or_si256(changed, _mm256_xor_si256(word, old));
+		avx2_store(dst + i, word);
+	}
+	return subtract_scalar(dst + i, src + i, n - i) | !_mm256_testz_si256(changed, changed);
+}
+
+CYREX_TARGET_AVX2 static bool transfer_avx2(Word* dst, const Word* gen, const Word* in, const Word* kill, const std::size_t n) {
+	__m256i changed = _mm256_setzero_si256();
+	std::size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const __m256i word = _mm256_or_si256(avx2_load(gen + i), _mm256_andnot_si256(avx2_load(kill + i), avx2_load(in + i)));
+		changed = _mm256_or_si256(changed, _mm256_xor_si256(word, avx2_load(dst + i)));
+		avx2_store(dst + i, word);
+	}
+	return transfer_scalar(dst + i, gen + i, in + i, kill + i, n - i) | !_mm256_testz_si256(changed, changed);
+}
+
+#endif
+
+constexpr static BitSetKernels scalar_kernels{ unite_scalar, intersect_scalar, subtract_scalar, transfer_scalar, Isa::Scalar };
+#ifdef CYREX_X64
+constexpr static BitSetKernels sse2_kernels{ unite_sse2, intersect_sse2, subtract_sse2, transfer_sse2, Isa::SSE2 };
+constexpr static BitSetKernels avx2_kernels{ unite_avx2, intersect_avx2, subtract_avx2, transfer_avx2, Isa::AVX2 };
+#endif
+
+const BitSetKernels* BitSetKernels::get(const Isa isa) {
+	switch (isa) {
+		case Isa::Scalar: return &scalar_kernels;
+#ifdef CYREX_X64
+		case Isa::SSE2: return &sse2_kernels;
+		case Isa::AVX2: {
+			static const bool has_avx2 = cpu_has_avx2();
+			return has_avx2 ? &avx2_kernels : nullptr;
+		}
+#endif
+	}
+	return nullptr;
+}
+
+const BitSetKernels& BitSetKernels::best() {
+	static const BitSetKernels& best = []() -> const BitSetKernels& {
+		for (const auto isa : { Isa::AVX2, Isa::SSE2 }) {
+			if (const auto* kernels = get(isa)) return *kernels;
+		}
+		return scalar_kernels;
+	}();
+	return best;
+}
+
+BitSet::BitSet(const std::size_t size, const bool full) : num_bits(size), storage((size + word_bits - 1) / word_bits, full ? ~Word{} : 0) {
+	if (full && size % word_bits) {
+		storage.back() >>= word_bits - size % word_bits;
+	}
+}
+
+void BitSet::clear() {
+	std::fill(storage.begin(), storage.end(), 0);
+}
+
+bool BitSet::empty() const {
+	return std::all_of(storage.begin(), storage.end(), [](const Word word) { return word == 0; });
+}
+
+std::size_t BitSet::count() const {
+	std::size_t n = 0;
+	for (const auto word : storage) {
+		n += std::popcount(word);
+	}
+	return n;
+}
+
+bool BitSet::unite(const BitSet& other) {
+	check_size(other);
+	return BitSetKernels::best().unite(storage.data(), other.storage.data(), storage.size());
+}
+
+bool BitSet::intersect(const BitSet& other) {
+	check_size(other);
+	return BitSetKernels::best().intersect(storage.data(), other.storage.data(), storage.size());
+}
+
+bool BitSet::subtract(const BitSet& other) {
+	check_size(other);
+	return BitSetKernels::best().subtract(storage.data(), other.storage.data(), storage.size());
+}
+
+bool BitSet::assign_transfer(const BitSet& gen, const BitSet& in, const BitSet& kill) {
+	check_size(gen);
+	check_size(in);
+	check_size(kill);
+	return BitSetKernels::best().transfer(storage.data(), gen.storage.data(), in.storage.data(), kill.storage.data(), storage.size());
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "cpu.hpp"
+#include <vector>
+#include <span>
+#include <bit>
+#include <cstdint>
+#include <stdexcept>
+
+// Word at a time set operations for the dataflow analyses. The sse2 and
+// avx2 kernels are picked the way the scanner is and give the same results.
+struct BitSetKernels {
+	using Word = std::uint64_t;
+
+	// every kernel works on n words and returns whether dst changed
+	bool (*unite)(Word* dst, const Word* src, std::size_t n);
+	bool (*intersect)(Word* dst, const Word* src, std::size_t n);
+	// dst without the bits of src
+	bool (*subtract)(Word* dst, const Word* src, std::size_t n);
+	// dst = gen | (in & ~kill), the transfer function of gen/kill problems
+	bool (*transfer)(Word* dst, const Word* gen, const Word* in, const Word* kill, std::size_t n);
+	Isa isa;
+
+	// the fastest kernels this cpu supports
+	static const BitSetKernels& best();
+	// nullptr if the isa is not supported by this build or cpu
+	static const BitSetKernels* get(Isa isa);
+};
+
+// A set of the integers [0, size), stored as one bit each.
+// Bits past the size are always clear, so whole words compare equal.
+class BitSet {
+public:
+	using Word = BitSetKernels::Word;
+	constexpr static std::size_t word_bits = 64;
+
+	BitSet() = default;
+	explicit BitSet(std::size_t size, bool full = false);
+
+	std::size_t size() const { return num_bits; }
+	std::span<const Word> words() const { return storage; }
+
+	bool contains(const std::size_t bit) const { return storage[bit / word_bits] >> (bit % word_bits) & 1; }
+	void insert(const std::size_t bit) { storage[bit / word_bits] |= Word{ 1 } << (bit % word_bits); }
+	void erase(const std::size_t bit) { storage[bit / word_bits] &= ~(Word{ 1 } << (bit % word_bits)); }
+	void clear();
+	bool empty() const;
+	std::size_t count() const;
+
+	// set operations with a set of the same size, they return whether this set changed
+	bool unite(const BitSet& other);
+	bool intersect(const BitSet& other);
+	bool subtract(const BitSet& other);
+	// this = gen | (in & ~kill)
+	bool assign_transfer(const BitSet& gen, const BitSet& in, const BitSet& kill);
+
+	// calls f with every bit in the set, in increasing order
+	template <typename F>
+	void for_each(F&& f) const {
+		for (std::size_t i = 0; i < storage.size(); ++i) {
+			for (Word word = storage[i]; word; word &= word - 1) {
+				f(i * word_bits + std::countr_zero(word));
+			}
+		}
+	}
+
+	bool operator==(const BitSet& other) const = default;
+
+private:
+	void check_size(const BitSet& other) const {
+		if (other.num_bits != num_bits) throw std::runtime_error("internal error: set operation on bit sets of different sizes");
+	}
+
+private:
+	std::size_t num_bits{};
+	std::vector<Word> storage;
+};
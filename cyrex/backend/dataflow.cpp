@@ -0,0 +1,226 @@
+#include "dataflow.hpp"
+#include <unordered_map>
+
+// Numbers the values some block reads before writing them, the only values
+// that can be live across blocks. Returns the index of every value.
+static std::vector<std::uint32_t> index_upward_exposed(const CFGFunction& fn, std::vector<ValueId>& values) {
+	std::vector<std::uint32_t> index(fn.values.size(), NoIndex);
+	// the last block that wrote every value
+	std::vector<BlockId> written_in(fn.values.size(), NoBlock);
+	for (BlockId block = 0; block < fn.blocks.size(); ++block) {
+		for (const auto& ins : fn.blocks[block].inst) {
+			for (const auto value : ins.used_values(fn.extra_operands)) {
+				if (written_in[value] != block && index[value] == NoIndex) {
+					index[value] = static_cast<std::uint32_t>(values.size());
+					values.push_back(value);
+				}
+			}
+			if (const auto value = ins.written_value(); value != NoValue) {
+				written_in[value] = block;
+			}
+		}
+	}
+	return index;
+}
+
+Liveness compute_liveness(const CFGFunction& fn, const std::span<const BlockId> rpo) {
+	Liveness liveness;
+	liveness.index = index_upward_exposed(fn, liveness.values);
+	const auto& index = liveness.index;
+
+	const auto num_blocks = fn.blocks.size();
+	BitVectorProblem<Direction::Backward, Meet::Union> problem{ .size = liveness.values.size() };
+	problem.gen.assign(num_blocks, BitSet(problem.size));
+	problem.kill.assign(num_blocks, BitSet(problem.size));
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		auto& gen = problem.gen[block];
+		auto& kill = problem.kill[block];
+		for (const auto& ins : fn.blocks[block].inst) {
+			for (const auto value : ins.used_values(fn.extra_operands)) {
+				if (index[value] != NoIndex && !kill.contains(index[value])) gen.insert(index[value]);
+			}
+			if (const auto value = ins.written_value(); value != NoValue && index[value] != NoIndex) {
+				kill.insert(index[value]);
+			}
+		}
+	}
+
+	auto result = solve_dataflow(fn, rpo, problem);
+	liveness.live_in = std::move(result.in);
+	liveness.live_out = std::move(result.out);
+	return liveness;
+}
+
+LastUses::LastUses(const CFGFunction& fn, const Liveness& liveness) : fn(fn), liveness(liveness), live(fn.values.size()), seen_in(fn.values.size(), NoBlock) {}
+
+std::span<const Death> LastUses::block(const BlockId block) {
+	// values not seen yet in the walk are live if they are live out
+	const auto is_live = [&](const ValueId value) {
+		return seen_in[value] == block ? live[value] : liveness.is_live_out(block, value);
+	};
+	const auto set_live = [&](const ValueId value, const bool is) {
+		seen_in[value] = block;
+		live[value] = is;
+	};
+
+	deaths.clear();
+	const auto& insts = fn.blocks[block].inst;
+	for (auto i = static_cast<std::uint32_t>(insts.size()); i-- > 0;) {
+		const auto& ins = insts[i];
+		const auto written = ins.written_value();
+		if (written != NoValue) {
+			// written and never read
+			if (!is_live(written)) deaths.push_back({ i, written });
+			set_live(written, false);
+		}
+		for (const auto value : ins.used_values(fn.extra_operands)) {
+			// a value the instruction also writes died above, or lives on in the new value
+			if (!is_live(value) && value != written) deaths.push_back({ i, value });
+			set_live(value, true);
+		}
+	}
+	std::reverse(deaths.begin(), deaths.end());
+	return deaths;
+}
+
+ReachingDefinitions compute_reaching_definitions(const CFGFunction& fn, const std::span<const BlockId> rpo) {
+	std::vector<ValueId> values;
+	const auto index = index_upward_exposed(fn, values);
+	const auto num_blocks = fn.blocks.size();
+
+	ReachingDefinitions reaching;
+	auto& definitions = reaching.definitions;
+	// the definitions of a block are contiguous, from block_first[block] to block_first[block + 1]
+	std::vector<std::uint32_t> block_first(num_blocks + 1);
+	// the definitions of value index i are value_defs[value_first[i]..value_first[i + 1]]
+	std::vector<std::uint32_t> value_first(values.size() + 1);
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		block_first[block] = static_cast<std::uint32_t>(definitions.size());
+		const auto& insts = fn.blocks[block].inst;
+		for (std::uint32_t i = 0; i < insts.size(); ++i) {
+			const auto value = insts[i].written_value();
+			if (value == NoValue || index[value] == NoIndex) continue;
+			definitions.push_back({ block, i, value });
+			++value_first[index[value] + 1];
+		}
+	}
+	block_first[num_blocks] = static_cast<std::uint32_t>(definitions.size());
+	for (std::size_t i = 0; i < values.size(); ++i) {
+		value_first[i + 1] += value_first[i];
+	}
+	std::vector<std::uint32_t> value_defs(definitions.size());
+	auto next_def = value_first;
+	for (std::uint32_t d = 0; d < definitions.size(); ++d) {
+		value_defs[next_def[index[definitions[d].value]]++] = d;
+	}
+
+	BitVectorProblem<Direction::Forward, Meet::Union> problem{ .size = definitions.size() };
+	problem.gen.assign(num_blocks, BitSet(problem.size));
+	problem.kill.assign(num_blocks, BitSet(problem.size));
+	// the last block that defined every value
+	std::vector<BlockId> seen_in(values.size(), NoBlock);
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		// backwards, so the first definition of a value seen is the one leaving the block
+		for (auto d = block_first[block + 1]; d-- > block_first[block];) {
+			const auto i = index[definitions[d].value];
+			if (seen_in[i] == block) continue;
+			seen_in[i] = block;
+			problem.gen[block].insert(d);
+			for (auto k = value_first[i]; k < value_first[i + 1]; ++k) {
+				problem.kill[block].insert(value_defs[k]);
+			}
+		}
+	}
+
+	auto result = solve_dataflow(fn, rpo, problem);
+	reaching.in = std::move(result.in);
+	reaching.out = std::move(result.out);
+	return reaching;
+}
+
+static bool is_pure_binary(const Opcode opcode) {
+	return opcode >= Opcode::Add && opcode <= Opcode::Xor;
+}
+
+struct ExpressionHash {
+	std::size_t operator()(const Expression& e) const {
+		const auto operands = static_cast<std::uint64_t>(static_cast<std::uint32_t>(e.lhs)) << 32 | static_cast<std::uint32_t>(e.rhs);
+		return std::hash<std::uint64_t>{}(operands * 31 + static_cast<std::uint64_t>(e.opcode));
+	}
+};
+
+AvailableExpressions compute_available_expressions(const CFGFunction& fn, const std::span<const BlockId> rpo) {
+	struct Occurrences {
+		std::uint32_t id = NoIndex;
+		BlockId last_block = NoBlock;
+		std::uint32_t num_blocks{};
+	};
+	std::unordered_map<Expression, Occurrences, ExpressionHash> occurrences;
+	const auto num_blocks = fn.blocks.size();
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		for (const auto& ins : fn.blocks[block].inst) {
+			if (!is_pure_binary(ins.opcode)) continue;
+			auto& occ = occurrences[{ ins.opcode, ins.operand(0), ins.operand(1) }];
+			if (occ.last_block != block) {
+				occ.last_block = block;
+				++occ.num_blocks;
+			}
+		}
+	}
+
+	// an expression computed in one block only is never available where it is computed again
+	AvailableExpressions available;
+	auto& expressions = available.expressions;
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		for (const auto& ins : fn.blocks[block].inst) {
+			if (!is_pure_binary(ins.opcode)) continue;
+			const Expression e{ ins.opcode, ins.operand(0), ins.operand(1) };
+			auto& occ = occurrences.at(e);
+			if (occ.num_blocks < 2 || occ.id != NoIndex) continue;
+			occ.id = static_cast<std::uint32_t>(expressions.size());
+			expressions.push_back(e);
+		}
+	}
+
+	// the expressions reading every value are readers[reader_first[v]..reader_first[v + 1]]
+	std::vector<std::uint32_t> reader_first(fn.values.size() + 1);
+	for (const auto& e : expressions) {
+		++reader_first[e.lhs + 1];
+		if (e.rhs != e.lhs) ++reader_first[e.rhs + 1];
+	}
+	for (std::size_t v = 0; v < fn.values.size(); ++v) {
+		reader_first[v + 1] += reader_first[v];
+	}
+	std::vector<std::uint32_t> readers(reader_first.back());
+	auto next_reader = reader_first;
+	for (std::uint32_t id = 0; id < expressions.size(); ++id) {
+		readers[next_reader[expressions[id].lhs]++] = id;
+		if (expressions[id].rhs != expressions[id].lhs) readers[next_reader[expressions[id].rhs]++] = id;
+	}
+
+	BitVectorProblem<Direction::Forward, Meet::Intersection> problem{ .size = expressions.size() };
+	problem.gen.assign(num_blocks, BitSet(problem.size));
+	problem.kill.assign(num_blocks, BitSet(problem.size));
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		auto& gen = problem.gen[block];
+		auto& kill = problem.kill[block];
+		for (const auto& ins : fn.blocks[block].inst) {
+			if (is_pure_binary(ins.opcode)) {
+				const auto id = occurrences.at({ ins.opcode, ins.operand(0), ins.operand(1) }).id;
+				if (id != NoIndex) gen.insert(id);
+			}
+			// after the expression is computed, so an instruction writing its own operand kills it
+			if (const auto value = ins.written_value(); value != NoValue) {
+				for (auto r = reader_first[value]; r < reader_first[value + 1]; ++r) {
+					gen.erase(readers[r]);
+					kill.insert(readers[r]);
+				}
+			}
+		}
+	}
+
+	auto result = solve_dataflow(fn, rpo, problem);
+	available.in = std::move(result.in);
+	available.out = std::move(result.out);
+	return available;
+}
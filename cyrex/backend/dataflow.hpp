@@ -0,0 +1,203 @@
+#pragma once
+#include "ir.hpp"
+#include "bitset.hpp"
+#include <algorithm>
+#include <span>
+#include <vector>
+
+enum class Direction : std::uint8_t {
+	Forward,
+	Backward,
+};
+
+// The values holding on entry to and on exit from every block
+template <typename Value>
+struct DataflowResult {
+	std::vector<Value> in;
+	std::vector<Value> out;
+};
+
+// Solves a dataflow problem over the blocks of a function with a worklist.
+// A problem has:
+//   using Value                     the lattice
+//   static constexpr Direction direction
+//   Value top() const               what the meet of no blocks gives
+//   Value boundary() const          what enters the entry block, or leaves blocks without successors
+//   void meet(Value& into, const Value& from) const
+//   bool transfer(BlockId block, const Value& input, Value& output) const
+//                                   output from the input of the block, returns whether output changed
+// The input is in for forward problems and out for backward ones.
+// rpo is the reachable blocks in reverse postorder, the others are solved after them.
+template <typename Problem>
+DataflowResult<typename Problem::Value> solve_dataflow(const CFGFunction& fn, const std::span<const BlockId> rpo, const Problem& problem) {
+	using Value = typename Problem::Value;
+	constexpr bool forward = Problem::direction == Direction::Forward;
+	const auto num_blocks = fn.blocks.size();
+	const Value top = problem.top();
+	const Value boundary = problem.boundary();
+	DataflowResult<Value> result{ std::vector<Value>(num_blocks, top), std::vector<Value>(num_blocks, top) };
+	auto& inputs = forward ? result.in : result.out;
+	auto& outputs = forward ? result.out : result.in;
+
+	// a block is queued at most once, so a ring of num_blocks entries holds the worklist.
+	// Predecessors come first for forward problems and successors for backward ones.
+	std::vector<BlockId> queue;
+	queue.reserve(num_blocks);
+	std::vector<bool> queued(num_blocks);
+	for (const auto block : rpo) {
+		queue.push_back(block);
+		queued[block] = true;
+	}
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		if (!queued[block]) {
+			queue.push_back(block);
+			queued[block] = true;
+		}
+	}
+	if (!forward) std::reverse(queue.begin(), queue.end());
+
+	std::size_t head = 0;
+	std::size_t size = queue.size();
+	Value joined = top;
+	while (size) {
+		const BlockId block = queue[head];
+		head = (head + 1) % num_blocks;
+		--size;
+		queued[block] = false;
+
+		const auto& bb = fn.blocks[block];
+		joined = top;
+		if (forward ? block == 0 : bb.successors.empty()) {
+			problem.meet(joined, boundary);
+		}
+		for (const auto neighbour : forward ? bb.predecessors : bb.successors) {
+			problem.meet(joined, outputs[neighbour]);
+		}
+		std::swap(inputs[block], joined);
+		if (!problem.transfer(block, inputs[block], outputs[block])) continue;
+
+		for (const auto neighbour : forward ? bb.successors : bb.predecessors) {
+			if (queued[neighbour]) continue;
+			queued[neighbour] = true;
+			queue[(head + size) % num_blocks] = neighbour;
+			++size;
+		}
+	}
+	return result;
+}
+
+enum class Meet : std::uint8_t {
+	Union,
+	Intersection,
+};
+
+// A problem whose values are sets, where every block adds the bits of gen
+// and removes the bits of kill it does not add
+template <Direction dir, Meet meet_kind>
+struct BitVectorProblem {
+	using Value = BitSet;
+	constexpr static Direction direction = dir;
+
+	std::size_t size{};
+	std::vector<BitSet> gen;
+	std::vector<BitSet> kill;
+
+	BitSet top() const { return BitSet(size, meet_kind == Meet::Intersection); }
+	BitSet boundary() const { return BitSet(size); }
+
+	void meet(BitSet& into, const BitSet& from) const {
+		if constexpr (meet_kind == Meet::Union) {
+			into.unite(from);
+		} else {
+			into.intersect(from);
+		}
+	}
+
+	bool transfer(const BlockId block, const BitSet& input, BitSet& output) const {
+		return output.assign_transfer(gen[block], input, kill[block]);
+	}
+};
+
+constexpr static std::uint32_t NoIndex = ~std::uint32_t{};
+
+// The values live on entry to and on exit from every block. The sets only
+// hold values that some block reads before writing them, the others are
+// never live across blocks.
+struct Liveness {
+	// the values the sets are over, and the position of every value of the function in them
+	std::vector<ValueId> values;
+	std::vector<std::uint32_t> index;
+	std::vector<BitSet> live_in;
+	std::vector<BitSet> live_out;
+
+	bool is_live_in(const BlockId block, const ValueId value) const {
+		return index[value] != NoIndex && live_in[block].contains(index[value]);
+	}
+	bool is_live_out(const BlockId block, const ValueId value) const {
+		return index[value] != NoIndex && live_out[block].contains(index[value]);
+	}
+};
+
+Liveness compute_liveness(const CFGFunction& fn, std::span<const BlockId> rpo);
+
+// A value that is not live after an instruction reading or writing it
+struct Death {
+	std::uint32_t inst{};
+	ValueId value{};
+};
+
+// The deaths of one block at a time, from the liveness of the function
+class LastUses {
+public:
+	LastUses(const CFGFunction& fn, const Liveness& liveness);
+
+	// in instruction order, the span is valid until the next call
+	std::span<const Death> block(BlockId block);
+
+private:
+	const CFGFunction& fn;
+	const Liveness& liveness;
+	std::vector<Death> deaths;
+	// whether every value is live at the point of the backward walk, for
+	// the values seen in the block the walk is in
+	std::vector<bool> live;
+	std::vector<BlockId> seen_in;
+};
+
+// A write of a value, the instruction is an index into the block
+struct Definition {
+	BlockId block{};
+	std::uint32_t inst{};
+	ValueId value{};
+};
+
+// The definitions reaching the entry and exit of every block. Only values
+// that some block reads before writing are tracked, like in Liveness. The
+// sets have a bit per definition, so they grow with definitions times blocks.
+struct ReachingDefinitions {
+	std::vector<Definition> definitions;
+	std::vector<BitSet> in;
+	std::vector<BitSet> out;
+};
+
+ReachingDefinitions compute_reaching_definitions(const CFGFunction& fn, std::span<const BlockId> rpo);
+
+// A pure instruction of two operands
+struct Expression {
+	Opcode opcode{};
+	ValueId lhs{};
+	ValueId rhs{};
+
+	bool operator==(const Expression&) const = default;
+};
+
+// The expressions computed on every path to the entry and exit of every
+// block, with none of their operands written since. Only expressions
+// computed in more than one block are tracked.
+struct AvailableExpressions {
+	std::vector<Expression> expressions;
+	std::vector<BitSet> in;
+	std::vector<BitSet> out;
+};
+
+AvailableExpressions compute_available_expressions(const CFGFunction& fn, std::span<const BlockId> rpo);
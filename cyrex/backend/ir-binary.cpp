@@ -0,0 +1,245 @@
+#include "ir-binary.hpp"
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <stdexcept>
+
+// appends the bytes of items at the next 8 byte boundary
+template <typename T>
+static BinaryIR::Range put(std::string& out, const std::span<const T> items) {
+	static_assert(std::is_trivially_copyable_v<T>);
+	out.resize((out.size() + 7) & ~std::size_t(7));
+	const BinaryIR::Range range{ out.size(), items.size() };
+	out.append(reinterpret_cast<const char*>(items.data()), items.size_bytes());
+	return range;
+}
+
+static BinaryIR::String put_string(std::string& pool, const std::string_view text) {
+	const BinaryIR::String string{ static_cast<std::uint32_t>(pool.size()), static_cast<std::uint32_t>(text.size()) };
+	pool += text;
+	return string;
+}
+
+void write_binary_ir(std::ostream& os, const Module& mod) {
+	std::string out(sizeof(BinaryIR::Header), '\0');
+	std::string pool;
+	BinaryIR::Header header{
+		.magic = BinaryIR::magic,
+		.version = BinaryIR::version,
+		.inst_size = sizeof(Inst),
+		.value_size = sizeof(Value) };
+
+	std::vector<BinaryIR::Type> types;
+	for (TypeId id = 0; id < mod.types.size(); ++id) {
+		const auto& info = mod.types.info(id);
+		BinaryIR::Type type{
+			.name = put_string(pool, info.type.name),
+			.size = info.size,
+			.align = info.align,
+			.reg_class = static_cast<std::uint8_t>(info.reg_class),
+			.num_qualifiers = info.type.num_qualifiers };
+		for (std::size_t i = 0; i < info.type.num_qualifiers; ++i) {
+			const auto& qual = info.type.qualifier_list[i];
+			type.qualifiers[i] = { .array_length = qual.array_length, .kind = static_cast<std::uint8_t>(qual.kind), .is_const = qual.is_const };
+		}
+		types.push_back(type);
+	}
+	header.types = put<BinaryIR::Type>(out, types);
+
+	std::vector<BinaryIR::Function> functions;
+	std::vector<BinaryIR::Block> blocks;
+	std::vector<std::int64_t> literals;
+	for (const auto& [name, fn] : mod.functions) {
+		BinaryIR::Function function{ .name = put_string(pool, name) };
+		function.values = put<Value>(out, fn.values);
+		literals.clear();
+		for (const auto& literal : fn.literals) {
+			literals.push_back(std::get<long>(literal.data));
+		}
+		function.literals = put<std::int64_t>(out, literals);
+		function.extra_operands = put<ValueId>(out, fn.extra_operands);
+
+		blocks.clear();
+		for (const auto& bb : fn.blocks) {
+			blocks.push_back({
+				.lbl_entry = bb.lbl_entry,
+				.insts = put<Inst>(out, bb.inst),
+				.successors = put<BlockId>(out, bb.successors),
+				.predecessors = put<BlockId>(out, bb.predecessors) });
+		}
+		function.blocks = put<BinaryIR::Block>(out, blocks);
+		functions.push_back(function);
+	}
+	header.functions = put<BinaryIR::Function>(out, functions);
+	header.strings = put<char>(out, pool);
+
+	std::memcpy(out.data(), &header, sizeof(header));
+	os.write(out.data(), out.size());
+}
+
+BinaryIRFile::BinaryIRFile(const std::string& filename) : file(filename) {
+	if (file.text().size() < sizeof(BinaryIR::Header) || header().magic != BinaryIR::magic) {
+		throw std::runtime_error(std::format("{} is not a binary IR file", filename));
+	}
+	if (header().version != BinaryIR::version) {
+		throw std::runtime_error(std::format("{} has binary IR version {}, expected {}", filename, header().version, BinaryIR::version));
+	}
+	if (header().inst_size != sizeof(Inst) || header().value_size != sizeof(Value)) {
+		throw std::runtime_error(std::format("{} was written by an incompatible build", filename));
+	}
+}
+
+const BinaryIR::Header& BinaryIRFile::header() const {
+	return *reinterpret_cast<const BinaryIR::Header*>(file.text().data());
+}
+
+template <typename T>
+std::span<const T> BinaryIRFile::array(const BinaryIR::Range& range) const {
+	const auto text = file.text();
+	if (range.offset % alignof(T) || range.offset > text.size() || range.count > (text.size() - range.offset) / sizeof(T)) {
+		throw std::runtime_error(std::format("{} is corrupt, an array is out of bounds", file.filename()));
+	}
+	return { reinterpret_cast<const T*>(text.data() + range.offset), static_cast<std::size_t>(range.count) };
+}
+
+std::string_view BinaryIRFile::string(const BinaryIR::String& string) const {
+	const auto pool = array<char>(header().strings);
+	if (string.offset > pool.size() || string.size > pool.size() - string.offset) {
+		throw std::runtime_error(std::format("{} is corrupt, a name is out of bounds", file.filename()));
+	}
+	return { pool.data() + string.offset, string.size };
+}
+
+// Checks every id of a copied function against the table it indexes, and
+// that the edges are the ones its terminators and predecessor lists give.
+// What is checked is what the backend indexes without checking.
+static void check_function(const CFGFunction& fn, const std::size_t num_types, const std::string& filename) {
+	const auto corrupt = [&](const std::string_view what) {
+		throw std::runtime_error(std::format("{} is corrupt, {}", filename, what));
+	};
+	const auto is_value = [&](const ValueId id) { return id >= 0 && static_cast<std::size_t>(id) < fn.values.size(); };
+
+	if (fn.blocks.empty()) corrupt("a function has no blocks");
+	for (const auto& value : fn.values) {
+		if (value.type >= num_types) corrupt("a value has an unknown type");
+		if (value.literal != NoLiteral && value.literal >= fn.literals.size()) corrupt("a literal is out of bounds");
+	}
+
+	// passes find blocks by the label they start with, which is the one of their header
+	const auto starts_with = [&](const BlockId block, const LabelId label) {
+		const auto& inst = fn.blocks[block].inst;
+		return !inst.empty() && inst.front().opcode == Opcode::Label && inst.front().operand(0) == label;
+	};
+
+	std::vector<std::pair<BlockId, BlockId>> edges;
+	std::vector<std::pair<BlockId, BlockId>> reverse_edges;
+	for (BlockId block = 0; block < fn.blocks.size(); ++block) {
+		const auto& bb = fn.blocks[block];
+		for (std::size_t i = 0; i < bb.inst.size(); ++i) {
+			const auto& ins = bb.inst[i];
+			if (ins.opcode > Opcode::Phi) corrupt("an instruction has an unknown opcode");
+			const auto [min_operands, max_operands] = operand_counts(ins.opcode);
+			if (ins.num_operands < min_operands || ins.num_operands > max_operands) corrupt("an instruction has the wrong number of operands");
+			if (!ins.is_inline() && (ins.storage[0] < 0 || static_cast<std::size_t>(ins.storage[0]) + ins.num_operands > fn.extra_operands.size())) {
+				corrupt("extra operands are out of bounds");
+			}
+			if (ins.opcode == Opcode::Phi && ins.num_operands != bb.predecessors.size()) corrupt("a phi does not read one operand per predecessor");
+			if (ins.opcode == Opcode::Label && (i != 0 || ins.operand(0) != bb.lbl_entry)) corrupt("a label is not the one of its block");
+			if (ins.is_block_terminator() && i + 1 != bb.inst.size()) corrupt("a block goes on after its terminator");
+
+			// values written and read, a return of nothing reads NoValue
+			const bool has_result = ins.opcode != Opcode::Store && !ins.is_block_terminator() && ins.opcode != Opcode::Label;
+			if (has_result ? !is_value(ins.result) : ins.result != NoValue) corrupt("an instruction writes an invalid value");
+			if (ins.opcode == Opcode::Store && !is_value(ins.operand(0))) corrupt("a store writes an invalid value");
+			if (ins.opcode == Opcode::Const && !fn.is_literal(ins.result)) corrupt("a constant has no literal");
+			for (const auto value : ins.used_values(fn.extra_operands)) {
+				if (!is_value(value)) corrupt("an instruction reads an invalid value");
+			}
+		}
+
+		// a block ends in its terminator or falls through into the epilogue
+		std::size_t num_successors = 0;
+		if (!bb.inst.empty()) {
+			switch (bb.inst.back().opcode) {
+				case Opcode::Branch: num_successors = 2; break;
+				case Opcode::Jump:
+				case Opcode::Return: num_successors = 1; break;
+				default: break;
+			}
+		}
+		if (bb.successors.size() != num_successors) corrupt("a block has the wrong number of successors");
+		for (std::size_t i = 0; i < bb.successors.size(); ++i) {
+			const auto succ = bb.successors[i];
+			if (succ >= fn.blocks.size()) corrupt("a successor is out of bounds");
+			// returns go to the epilogue, jumps and branches to the blocks of their labels in order
+			const auto& terminator = bb.inst.back();
+			if (terminator.opcode == Opcode::Return ? succ + 1 != fn.blocks.size() : !starts_with(succ, terminator.operand(terminator.opcode == Opcode::Branch ? 1 + i : 0))) {
+				corrupt("a successor is not the block its terminator goes to");
+			}
+			edges.push_back({ block, succ });
+		}
+		for (const auto pred : bb.predecessors) {
+			if (pred >= fn.blocks.size()) corrupt("a predecessor is out of bounds");
+			reverse_edges.push_back({ pred, block });
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	std::sort(reverse_edges.begin(), reverse_edges.end());
+	if (edges != reverse_edges) corrupt("successors and predecessors disagree");
+}
+
+Module BinaryIRFile::to_module() const {
+	Module mod;
+
+	// types were written in TypeId order, so interning them again gives the same ids
+	for (const auto& record : types()) {
+		AST::Type type{ .name = string(record.name) };
+		if (record.num_qualifiers > record.qualifiers.size()) {
+			throw std::runtime_error(std::format("{} is corrupt, a type has too many qualifiers", file.filename()));
+		}
+		for (std::size_t i = 0; i < record.num_qualifiers; ++i) {
+			const auto& qual = record.qualifiers[i];
+			if (qual.kind > static_cast<std::uint8_t>(AST::Type::Qualifier::Kind::Array)) {
+				throw std::runtime_error(std::format("{} is corrupt, a type qualifier is unknown", file.filename()));
+			}
+			type.add_qualifier({
+				.is_const = qual.is_const != 0,
+				.kind = static_cast<AST::Type::Qualifier::Kind>(qual.kind),
+				.array_length = qual.array_length });
+		}
+		const auto expected = static_cast<TypeId>(mod.types.size());
+		if (mod.types.intern(type) != expected) {
+			throw std::runtime_error(std::format("{} is corrupt, a type is stored twice", file.filename()));
+		}
+	}
+
+	for (const auto& record : functions()) {
+		const std::string name(string(record.name));
+		if (mod.functions.contains(name)) {
+			throw std::runtime_error(std::format("{} is corrupt, function {} is stored twice", file.filename(), name));
+		}
+		auto& fn = mod.functions[name];
+		const auto values = this->values(record);
+		fn.values.assign(values.begin(), values.end());
+		for (const auto literal : literals(record)) {
+			fn.literals.push_back({ static_cast<long>(literal) });
+		}
+		const auto extra = extra_operands(record);
+		fn.extra_operands.assign(extra.begin(), extra.end());
+
+		const auto blocks = this->blocks(record);
+		fn.blocks.resize(blocks.size());
+		for (std::size_t i = 0; i < blocks.size(); ++i) {
+			auto& bb = fn.blocks[i];
+			bb.lbl_entry = blocks[i].lbl_entry;
+			const auto inst = insts(blocks[i]);
+			bb.inst.assign(inst.begin(), inst.end());
+			const auto succs = successors(blocks[i]);
+			bb.successors.assign(succs.begin(), succs.end());
+			const auto preds = predecessors(blocks[i]);
+			bb.predecessors.assign(preds.begin(), preds.end());
+		}
+		check_function(fn, mod.types.size(), file.filename());
+	}
+	return mod;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include "ir.hpp"
+#include "frontend/source.hpp"
+#include <span>
+#include <array>
+#include <ostream>
+
+// The binary IR format. A file is a header followed by arrays of fixed
+// size records, which refer to each other by offsets from the start of
+// the file. Names are ranges of a string pool. Instructions and values are
+// stored exactly as in memory, so a mapped file is used in place.
+struct BinaryIR {
+	constexpr static std::array<char, 4> magic = { 'C', 'Y', 'I', 'R' };
+	constexpr static std::uint32_t version = 1;
+
+	// count records of a type starting at offset
+	struct Range {
+		std::uint64_t offset{};
+		std::uint64_t count{};
+	};
+
+	// a range of the string pool
+	struct String {
+		std::uint32_t offset{};
+		std::uint32_t size{};
+	};
+
+	struct Header {
+		std::array<char, 4> magic{};
+		std::uint32_t version{};
+		// in-place records are only valid for the layout they were written with
+		std::uint32_t inst_size{};
+		std::uint32_t value_size{};
+		Range types;
+		Range functions;
+		Range strings;
+	};
+
+	struct Qualifier {
+		std::int32_t array_length{};
+		std::uint8_t kind{};
+		std::uint8_t is_const{};
+	};
+
+	// in TypeId order
+	struct Type {
+		String name;
+		std::uint32_t size{};
+		std::uint32_t align{};
+		std::uint8_t reg_class{};
+		std::uint8_t num_qualifiers{};
+		std::array<Qualifier, AST::Type::max_qualifiers> qualifiers{};
+	};
+
+	struct Function {
+		String name;
+		Range values;
+		// one 64 bit integer per literal
+		Range literals;
+		Range extra_operands;
+		Range blocks;
+	};
+
+	struct Block {
+		LabelId lbl_entry{};
+		Range insts;
+		Range successors;
+		Range predecessors;
+	};
+};
+
+void write_binary_ir(std::ostream& os, const Module& mod);
+
+// A binary IR file mapped into memory. The header is checked when the
+// file is opened, and every array when it is accessed. to_module also
+// checks every id in the records against the table it indexes.
+class BinaryIRFile {
+public:
+	explicit BinaryIRFile(const std::string& filename);
+
+	const BinaryIR::Header& header() const;
+	std::span<const BinaryIR::Type> types() const { return array<BinaryIR::Type>(header().types); }
+	std::span<const BinaryIR::Function> functions() const { return array<BinaryIR::Function>(header().functions); }
+	std::span<const Value> values(const BinaryIR::Function& fn) const { return array<Value>(fn.values); }
+	std::span<const std::int64_t> literals(const BinaryIR::Function& fn) const { return array<std::int64_t>(fn.literals); }
+	std::span<const ValueId> extra_operands(const BinaryIR::Function& fn) const { return array<ValueId>(fn.extra_operands); }
+	std::span<const BinaryIR::Block> blocks(const BinaryIR::Function& fn) const { return array<BinaryIR::Block>(fn.blocks); }
+	std::span<const Inst> insts(const BinaryIR::Block& block) const { return array<Inst>(block.insts); }
+	std::span<const BlockId> successors(const BinaryIR::Block& block) const { return array<BlockId>(block.successors); }
+	std::span<const BlockId> predecessors(const BinaryIR::Block& block) const { return array<BlockId>(block.predecessors); }
+	std::string_view string(const BinaryIR::String& string) const;
+
+	// copies every record into a Module the backend can transform
+	Module to_module() const;
+
+private:
+	template <typename T>
+	std::span<const T> array(const BinaryIR::Range& range) const;
+
+private:
+	SourceBuffer file;
+};
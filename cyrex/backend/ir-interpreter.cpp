@@ -0,0 +1,122 @@
+#include "ir-interpreter.hpp"
+#include "frontend/semantics.hpp"
+#include <algorithm>
+#include <limits>
+
+// functions the interpreter folds and constants the frontend folds give the same values
+static constexpr bool agrees_with_frontend(const Opcode opcode, const AST::BinaryExpr::Kind kind) {
+	constexpr std::int64_t values[] = { 0, 1, 3, 4, 6, -1, -8, std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min() };
+	for (const auto a : values) {
+		for (const auto b : values) {
+			if (evaluate_binary(opcode, a, b) != fold_binary(kind, a, b)) return false;
+		}
+	}
+	return true;
+}
+static_assert(agrees_with_frontend(Opcode::Add, AST::BinaryExpr::Kind::Add));
+static_assert(agrees_with_frontend(Opcode::Sub, AST::BinaryExpr::Kind::Sub));
+static_assert(agrees_with_frontend(Opcode::Lesser, AST::BinaryExpr::Kind::CmpLesser));
+static_assert(agrees_with_frontend(Opcode::LesserOrEqual, AST::BinaryExpr::Kind::CmpLesserOrEqual));
+static_assert(agrees_with_frontend(Opcode::Greater, AST::BinaryExpr::Kind::CmpGreater));
+static_assert(agrees_with_frontend(Opcode::GreaterOrEqual, AST::BinaryExpr::Kind::CmpGreaterOrEqual));
+static_assert(agrees_with_frontend(Opcode::Equal, AST::BinaryExpr::Kind::CmpEqual));
+static_assert(agrees_with_frontend(Opcode::NotEqual, AST::BinaryExpr::Kind::CmpNotEqual));
+static_assert(agrees_with_frontend(Opcode::And, AST::BinaryExpr::Kind::CmpAnd));
+static_assert(agrees_with_frontend(Opcode::Or, AST::BinaryExpr::Kind::CmpOr));
+static_assert(agrees_with_frontend(Opcode::Xor, AST::BinaryExpr::Kind::CmpXor));
+
+Evaluation IRInterpreter::run(const CFGFunction& fn) {
+	slots.assign(fn.values.size(), 0);
+	defined.assign(fn.values.size(), false);
+	Evaluation evaluation;
+	if (fn.blocks.empty()) return evaluation;
+
+	BlockId block = 0;
+	std::size_t next = 0;
+	// the phis of a block all read their operands before any of them is written
+	const auto enter = [&](const BlockId target) {
+		const auto from = block;
+		block = target;
+		next = 0;
+		const auto& bb = fn.blocks[target];
+		const auto edge = std::find(bb.predecessors.begin(), bb.predecessors.end(), from) - bb.predecessors.begin();
+		incoming.clear();
+		for (const auto& ins : bb.inst) {
+			if (ins.opcode == Opcode::Label) continue;
+			if (ins.opcode != Opcode::Phi) break;
+			// falling through is not an edge, the phis of the block get nothing
+			const auto operands = ins.operands(fn.extra_operands);
+			const auto value = static_cast<std::size_t>(edge) < operands.size() ? operands[edge] : NoValue;
+			incoming.push_back(value != NoValue && defined[value] ? std::optional(slots[value]) : std::nullopt);
+		}
+		auto phi = incoming.begin();
+		for (const auto& ins : bb.inst) {
+			if (ins.opcode == Opcode::Label) continue;
+			if (ins.opcode != Opcode::Phi) break;
+			defined[ins.result] = phi->has_value();
+			if (*phi) slots[ins.result] = **phi;
+			++phi;
+		}
+	};
+
+	while (true) {
+		const auto& bb = fn.blocks[block];
+		if (next == bb.inst.size()) {
+			// only the last block ends without a terminator, returns jump to it
+			if (block + 1 == fn.blocks.size()) return evaluation;
+			enter(block + 1);
+			continue;
+		}
+		if (evaluation.steps == max_steps) {
+			evaluation.status = Evaluation::Status::OutOfSteps;
+			return evaluation;
+		}
+		++evaluation.steps;
+
+		const auto& ins = bb.inst[next++];
+		// phis only read the operand of the edge taken, on entry
+		for (const auto value : ins.opcode == Opcode::Phi ? std::span<const ValueId>() : ins.used_values(fn.extra_operands)) {
+			if (value < 0 || static_cast<std::size_t>(value) >= slots.size() || !defined[value]) {
+				evaluation.status = Evaluation::Status::Undefined;
+				return evaluation;
+			}
+		}
+
+		const auto arg = [&](const std::size_t index) { return slots[ins.operand(index)]; };
+		const auto set = [&](const ValueId value, const std::int64_t x) {
+			slots[value] = x;
+			defined[value] = true;
+		};
+		using enum Opcode;
+		switch (ins.opcode) {
+			// a new variable holds nothing until it is stored to
+			case Alloc: defined[ins.result] = false; break;
+			case Const: set(ins.result, std::get<long>(fn.literal(ins.result).data)); break;
+			case Store: set(ins.operand(0), arg(1)); break;
+			case Load: set(ins.result, arg(0)); break;
+			case Add:
+			case Sub:
+			case Lesser:
+			case LesserOrEqual:
+			case Greater:
+			case GreaterOrEqual:
+			case Equal:
+			case NotEqual:
+			case And:
+			case Or:
+			case Xor:
+			set(ins.result, evaluate_binary(ins.opcode, arg(0), arg(1)));
+			break;
+			case Label: break;
+			// the successors are in the order of the labels
+			case Branch: enter(bb.successors[arg(0) ? 0 : 1]); break;
+			case Jump: enter(bb.successors[0]); break;
+			case Return:
+			evaluation.value = ins.operand(0) == NoValue ? std::nullopt : std::optional(arg(0));
+			enter(bb.successors[0]);
+			break;
+			// written on entry to the block, a phi reading an undefined value leaves its own undefined
+			case Phi: break;
+		}
+	}
+}
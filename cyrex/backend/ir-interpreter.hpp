@@ -0,0 +1,66 @@
+#pragma once
+#include "ir.hpp"
+#include <optional>
+
+// steps the optimizer may spend evaluating a function
+constexpr static std::size_t default_eval_steps = 1'000'000;
+
+// an instruction of two operands, with the semantics the frontend folds
+// constants with: integers wrap and &, | and ^ are bitwise
+constexpr std::int64_t evaluate_binary(const Opcode opcode, const std::int64_t a, const std::int64_t b) {
+	using enum Opcode;
+	// two's complement wrapping, which signed overflow does not promise
+	const auto ua = static_cast<std::uint64_t>(a);
+	const auto ub = static_cast<std::uint64_t>(b);
+	switch (opcode) {
+		case Add: return static_cast<std::int64_t>(ua + ub);
+		case Sub: return static_cast<std::int64_t>(ua - ub);
+		case Lesser: return a < b;
+		case LesserOrEqual: return a <= b;
+		case Greater: return a > b;
+		case GreaterOrEqual: return a >= b;
+		case Equal: return a == b;
+		case NotEqual: return a != b;
+		case And: return a & b;
+		case Or: return a | b;
+		case Xor: return a ^ b;
+		default: throw std::runtime_error("internal error: not an instruction of two operands");
+	}
+}
+
+// The outcome of running a function
+struct Evaluation {
+	enum class Status : std::uint8_t {
+		Returned,
+		// the step budget ran out, the function may never return
+		OutOfSteps,
+		// a value was read before anything wrote it, such as a variable
+		// without an initializer, so the result depends on the machine
+		Undefined,
+	};
+
+	Status status{};
+	// nullopt for functions returning nothing
+	std::optional<std::int64_t> value;
+	// instructions executed
+	std::size_t steps{};
+};
+
+// Executes the IR of a function directly. Integers are 64 bits wide and
+// wrap, as in the registers the backend keeps them in, so a function
+// returns what its compiled code puts in rax. Functions have no inputs and
+// no side effects, so a function that returns always returns the same value.
+class IRInterpreter {
+public:
+	explicit IRInterpreter(const std::size_t max_steps = default_eval_steps) : max_steps(max_steps) {}
+
+	Evaluation run(const CFGFunction& fn);
+
+private:
+	std::size_t max_steps;
+	// the value of every value of the function, reused between runs
+	std::vector<std::int64_t> slots;
+	std::vector<bool> defined;
+	// what the phis of the block being entered read, nullopt for undefined values
+	std::vector<std::optional<std::int64_t>> incoming;
+};
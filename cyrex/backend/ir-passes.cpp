@@ -0,0 +1,519 @@
+#include "ir-passes.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+std::size_t remove_unreachable_blocks(CFGFunction& fn, FunctionAnalyses& analyses) {
+	const auto& order = analyses.cfg_order();
+	auto& blocks = fn.blocks;
+	const BlockId exit = static_cast<BlockId>(blocks.size() - 1);
+
+	// new index of every kept block
+	std::vector<BlockId> remap(blocks.size(), NoBlock);
+	BlockId num_kept = 0;
+	for (BlockId i = 0; i < blocks.size(); ++i) {
+		if (order.is_reachable(i) || i == exit) {
+			remap[i] = num_kept++;
+		}
+	}
+	const std::size_t removed = blocks.size() - num_kept;
+	if (!removed) return 0;
+
+	std::vector<ValueId> operands;
+	for (BlockId i = 0; i < blocks.size(); ++i) {
+		if (remap[i] == NoBlock) continue;
+		auto& bb = blocks[i];
+		for (auto& succ : bb.successors) {
+			succ = remap[succ];
+		}
+		// kept blocks only jump to kept blocks, but may be jumped to from removed ones,
+		// whose phi operands go with them
+		for (auto& ins : bb.inst) {
+			if (ins.opcode != Opcode::Phi) continue;
+			operands.clear();
+			const auto incoming = ins.operands(fn.extra_operands);
+			for (std::size_t edge = 0; edge < incoming.size(); ++edge) {
+				if (remap[bb.predecessors[edge]] != NoBlock) operands.push_back(incoming[edge]);
+			}
+			if (operands.size() != incoming.size()) ins = Inst::make(Opcode::Phi, ins.result, operands, fn.extra_operands);
+		}
+		std::erase_if(bb.predecessors, [&](const BlockId pred) { return remap[pred] == NoBlock; });
+		for (auto& pred : bb.predecessors) {
+			pred = remap[pred];
+		}
+		if (remap[i] != i) {
+			blocks[remap[i]] = std::move(bb);
+		}
+	}
+	blocks.resize(num_kept);
+	return removed;
+}
+
+// a function of constants and a return, which folding would not change
+static bool is_folded(const CFGFunction& fn) {
+	if (fn.blocks.size() != 2) return false;
+	return std::all_of(fn.blocks[0].inst.begin(), fn.blocks[0].inst.end(), [](const Inst& ins) {
+		return ins.opcode == Opcode::Label || ins.opcode == Opcode::Const || ins.opcode == Opcode::Return;
+	});
+}
+
+std::size_t fold_evaluated_function(CFGFunction& fn, FunctionAnalyses&, const std::size_t max_steps) {
+	if (fn.blocks.size() < 2 || is_folded(fn)) return 0;
+	const auto evaluation = IRInterpreter(max_steps).run(fn);
+	if (evaluation.status != Evaluation::Status::Returned) return 0;
+
+	const auto& entry = fn.blocks.front();
+	CFGFunction folded;
+	BasicBlock body{ .lbl_entry = entry.lbl_entry, .successors = { 1 } };
+	if (!entry.inst.empty() && entry.inst.front().opcode == Opcode::Label) {
+		body.inst.push_back(entry.inst.front());
+	}
+	ValueId result = NoValue;
+	if (evaluation.value) {
+		// every return of a value returns the same type
+		TypeId type{};
+		for (const auto& bb : fn.blocks) {
+			if (!bb.inst.empty() && bb.inst.back().opcode == Opcode::Return && bb.inst.back().operand(0) != NoValue) {
+				type = fn.values[bb.inst.back().operand(0)].type;
+				break;
+			}
+		}
+		result = 0;
+		folded.values.push_back({ .type = type, .literal = 0 });
+		folded.literals.push_back({ static_cast<long>(*evaluation.value) });
+		body.inst.push_back(Inst::make(Opcode::Const, result, {}));
+	}
+	body.inst.push_back(Inst::make(Opcode::Return, NoValue, { result }));
+
+	BasicBlock epilogue = std::move(fn.blocks.back());
+	epilogue.successors.clear();
+	epilogue.predecessors = { 0 };
+	folded.blocks.push_back(std::move(body));
+	folded.blocks.push_back(std::move(epilogue));
+	fn = std::move(folded);
+	return 1;
+}
+
+std::size_t fold_constants(CFGFunction& fn, FunctionAnalyses& analyses) {
+	const auto& order = analyses.cfg_order();
+	const auto literal = [&](const ValueId id) { return std::get<long>(fn.literal(id).data); };
+
+	// a result written again is a variable, and not the value of one instruction
+	std::vector<std::uint32_t> writes(fn.values.size());
+	for (const auto& bb : fn.blocks) {
+		for (const auto& ins : bb.inst) {
+			if (ins.written_value() != NoValue) ++writes[ins.written_value()];
+		}
+	}
+
+	std::size_t folded = 0;
+	// reverse postorder reaches the operands of a value written once before the value
+	for (const auto block : order.rpo) {
+		auto& bb = fn.blocks[block];
+		for (auto& ins : bb.inst) {
+			if (ins.opcode >= Opcode::Add && ins.opcode <= Opcode::Xor) {
+				if (writes[ins.result] != 1 || !fn.is_literal(ins.operand(0)) || !fn.is_literal(ins.operand(1))) continue;
+				const auto value = evaluate_binary(ins.opcode, literal(ins.operand(0)), literal(ins.operand(1)));
+				fn.values[ins.result].literal = static_cast<std::uint32_t>(fn.literals.size());
+				fn.literals.push_back({ static_cast<long>(value) });
+				ins = Inst::make(Opcode::Const, ins.result, {});
+				++folded;
+			} else if (ins.opcode == Opcode::Branch && fn.is_literal(ins.operand(0))) {
+				const std::size_t taken = literal(ins.operand(0)) ? 0 : 1;
+				const BlockId target = bb.successors[taken];
+				const BlockId dropped = bb.successors[1 - taken];
+				ins = Inst::make(Opcode::Jump, NoValue, { ins.operand(1 + taken) });
+				bb.successors = { target };
+
+				// the dropped block loses the edge and the phi operands read on it
+				auto& succ = fn.blocks[dropped];
+				const auto edge = static_cast<std::size_t>(std::find(succ.predecessors.begin(), succ.predecessors.end(), block) - succ.predecessors.begin());
+				std::vector<ValueId> operands;
+				for (auto& phi : succ.inst) {
+					if (phi.opcode != Opcode::Phi) continue;
+					const auto incoming = phi.operands(fn.extra_operands);
+					operands.assign(incoming.begin(), incoming.end());
+					operands.erase(operands.begin() + edge);
+					phi = Inst::make(Opcode::Phi, phi.result, operands, fn.extra_operands);
+				}
+				succ.predecessors.erase(succ.predecessors.begin() + edge);
+				++folded;
+			}
+		}
+	}
+	return folded;
+}
+
+// the position of the first instruction after the label and phis of a block
+static std::size_t after_phis(const BasicBlock& bb) {
+	std::size_t i = !bb.inst.empty() && bb.inst.front().opcode == Opcode::Label;
+	while (i < bb.inst.size() && bb.inst[i].opcode == Opcode::Phi) ++i;
+	return i;
+}
+
+std::size_t promote_variables(CFGFunction& fn, FunctionAnalyses& analyses) {
+	if (fn.blocks.empty()) return 0;
+	const auto& order = analyses.cfg_order();
+	const auto& dominators = analyses.dominators();
+	const auto& frontiers = analyses.dominance_frontiers();
+	const auto& liveness = analyses.liveness();
+	const auto num_blocks = static_cast<BlockId>(fn.blocks.size());
+
+	// the variables are the values stored to or written more than once. An
+	// alloc nothing stores to is an undefined value, such as the ones renaming
+	// leaves for reads of variables nothing wrote.
+	std::vector<bool> is_written(fn.values.size());
+	std::vector<bool> is_variable(fn.values.size());
+	for (const auto& bb : fn.blocks) {
+		for (const auto& ins : bb.inst) {
+			const auto value = ins.written_value();
+			if (value == NoValue) continue;
+			if (ins.opcode == Opcode::Store || is_written[value]) is_variable[value] = true;
+			is_written[value] = true;
+		}
+	}
+	std::vector<std::uint32_t> var_index(fn.values.size(), NoIndex);
+	std::vector<ValueId> vars;
+	for (ValueId value = 0; value < static_cast<ValueId>(fn.values.size()); ++value) {
+		if (!is_variable[value]) continue;
+		var_index[value] = static_cast<std::uint32_t>(vars.size());
+		vars.push_back(value);
+	}
+	if (vars.empty()) return 0;
+
+	// new values are never variables
+	const auto new_value = [&](const ValueId like) {
+		const auto value = static_cast<ValueId>(fn.values.size());
+		fn.values.push_back({ .type = fn.values[like].type });
+		var_index.push_back(NoIndex);
+		return value;
+	};
+
+	// the reachable blocks writing every variable
+	std::vector<std::vector<BlockId>> def_blocks(vars.size());
+	for (const auto block : order.rpo) {
+		for (const auto& ins : fn.blocks[block].inst) {
+			const auto value = ins.written_value();
+			if (value == NoValue || var_index[value] == NoIndex) continue;
+			auto& blocks = def_blocks[var_index[value]];
+			if (blocks.empty() || blocks.back() != block) blocks.push_back(block);
+		}
+	}
+
+	// phis go on the iterated dominance frontier of the writes, where the
+	// variable is live, their operands are the variable until renaming
+	const auto first_phi = static_cast<ValueId>(fn.values.size());
+	std::vector<std::uint32_t> phi_var;
+	std::vector<std::uint32_t> has_phi(num_blocks, NoIndex);
+	std::vector<std::uint32_t> was_queued(num_blocks, NoIndex);
+	std::vector<BlockId> worklist;
+	std::vector<ValueId> operands;
+	// the instructions the pass inserted, dropped or changed
+	std::size_t rewritten = 0;
+	for (std::uint32_t var = 0; var < vars.size(); ++var) {
+		worklist = def_blocks[var];
+		for (const auto block : worklist) {
+			was_queued[block] = var;
+		}
+		while (!worklist.empty()) {
+			const auto block = worklist.back();
+			worklist.pop_back();
+			for (const auto y : frontiers.frontier(block)) {
+				if (has_phi[y] == var || !liveness.is_live_in(y, vars[var])) continue;
+				has_phi[y] = var;
+				auto& bb = fn.blocks[y];
+				operands.assign(bb.predecessors.size(), vars[var]);
+				const std::ptrdiff_t position = !bb.inst.empty() && bb.inst.front().opcode == Opcode::Label;
+				bb.inst.insert(bb.inst.begin() + position, Inst::make(Opcode::Phi, new_value(vars[var]), operands, fn.extra_operands));
+				phi_var.push_back(var);
+				++rewritten;
+				if (was_queued[y] != var) {
+					was_queued[y] = var;
+					worklist.push_back(y);
+				}
+			}
+		}
+	}
+
+	// renaming walks the dominator tree, the unreachable blocks are walked
+	// on their own and see every variable undefined
+	std::vector<ValueId> current(vars.size(), NoValue);
+	struct Change {
+		std::uint32_t var;
+		ValueId previous;
+	};
+	std::vector<Change> changes;
+	const auto set = [&](const std::uint32_t var, const ValueId value) {
+		changes.push_back({ var, current[var] });
+		current[var] = value;
+	};
+	// reads of a variable nothing wrote read an alloc of their own, an undefined value
+	std::vector<ValueId> undefined(vars.size(), NoValue);
+	const auto read = [&](const std::uint32_t var) {
+		if (current[var] != NoValue) return current[var];
+		if (undefined[var] == NoValue) undefined[var] = new_value(vars[var]);
+		return undefined[var];
+	};
+
+	std::vector<Inst> kept;
+	const auto rename = [&](const BlockId block) {
+		auto& bb = fn.blocks[block];
+		kept.clear();
+		for (auto ins : bb.inst) {
+			if (ins.opcode == Opcode::Phi && ins.result >= first_phi) {
+				set(phi_var[ins.result - first_phi], ins.result);
+				kept.push_back(ins);
+				continue;
+			}
+			// phis read their operands in the predecessors
+			bool is_renamed = false;
+			if (ins.opcode != Opcode::Phi) {
+				for (auto& value : ins.used_values(fn.extra_operands)) {
+					if (var_index[value] == NoIndex) continue;
+					value = read(var_index[value]);
+					is_renamed = true;
+				}
+			}
+			const auto written = ins.written_value();
+			if (written != NoValue && var_index[written] != NoIndex) {
+				const auto var = var_index[written];
+				++rewritten;
+				switch (ins.opcode) {
+					case Opcode::Alloc: set(var, NoValue); continue;
+					case Opcode::Store: set(var, ins.operand(1)); continue;
+					case Opcode::Load: set(var, ins.operand(0)); continue;
+					default:
+					ins.result = new_value(written);
+					set(var, ins.result);
+					kept.push_back(ins);
+					continue;
+				}
+			}
+			rewritten += is_renamed;
+			kept.push_back(ins);
+		}
+		bb.inst.swap(kept);
+
+		for (const auto succ : bb.successors) {
+			auto& succ_bb = fn.blocks[succ];
+			for (std::size_t edge = 0; edge < succ_bb.predecessors.size(); ++edge) {
+				if (succ_bb.predecessors[edge] != block) continue;
+				for (auto& ins : succ_bb.inst) {
+					if (ins.opcode == Opcode::Label) continue;
+					if (ins.opcode != Opcode::Phi) break;
+					auto& value = ins.operands(fn.extra_operands)[edge];
+					if (var_index[value] == NoIndex) continue;
+					value = read(var_index[value]);
+					++rewritten;
+				}
+			}
+		}
+	};
+
+	struct Frame {
+		BlockId block;
+		std::uint32_t next_child;
+		std::size_t first_change;
+	};
+	std::vector<Frame> stack{ { 0, 0, 0 } };
+	rename(0);
+	while (!stack.empty()) {
+		const auto top = stack.size() - 1;
+		const auto children = dominators.children(stack[top].block);
+		if (stack[top].next_child < children.size()) {
+			const auto child = children[stack[top].next_child++];
+			stack.push_back({ child, 0, changes.size() });
+			rename(child);
+			continue;
+		}
+		for (auto i = changes.size(); i-- > stack[top].first_change;) {
+			current[changes[i].var] = changes[i].previous;
+		}
+		changes.resize(stack[top].first_change);
+		stack.pop_back();
+	}
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		if (order.is_reachable(block)) continue;
+		rename(block);
+		for (const auto& change : changes) {
+			current[change.var] = NoValue;
+		}
+		changes.clear();
+	}
+
+	auto& entry = fn.blocks.front();
+	auto position = entry.inst.begin() + static_cast<std::ptrdiff_t>(after_phis(entry));
+	for (const auto value : undefined) {
+		if (value != NoValue) position = entry.inst.insert(position, Inst::make(Opcode::Alloc, value, {})) + 1;
+	}
+	return rewritten;
+}
+
+// Copies that all read before any of them writes. A source that another
+// copy writes is saved in a value of its own first.
+static void push_parallel_copies(CFGFunction& fn, std::vector<Inst>& inst, const std::size_t position, std::vector<std::pair<ValueId, ValueId>>& copies, std::vector<bool>& is_written) {
+	for (const auto& [dst, src] : copies) {
+		is_written[dst] = true;
+	}
+	std::vector<Inst> sequence;
+	for (auto& [dst, src] : copies) {
+		if (!is_written[src]) continue;
+		const auto saved = static_cast<ValueId>(fn.values.size());
+		fn.values.push_back({ .type = fn.values[dst].type });
+		sequence.push_back(Inst::make(Opcode::Load, saved, { src }));
+		src = saved;
+	}
+	for (const auto& [dst, src] : copies) {
+		sequence.push_back(Inst::make(Opcode::Load, dst, { src }));
+		is_written[dst] = false;
+	}
+	inst.insert(inst.begin() + static_cast<std::ptrdiff_t>(position), sequence.begin(), sequence.end());
+}
+
+// labels of new blocks are taken from next_label
+static std::size_t lower_function_phis(CFGFunction& fn, LabelId& next_label) {
+	const auto num_blocks = static_cast<BlockId>(fn.blocks.size());
+	const auto has_phis = std::any_of(fn.blocks.begin(), fn.blocks.end(), [](const BasicBlock& bb) {
+		return after_phis(bb) != (!bb.inst.empty() && bb.inst.front().opcode == Opcode::Label);
+	});
+	if (!has_phis) return 0;
+
+	std::vector<std::uint32_t> uses(fn.values.size());
+	for (const auto& bb : fn.blocks) {
+		for (const auto& ins : bb.inst) {
+			for (const auto value : ins.used_values(fn.extra_operands)) ++uses[value];
+		}
+	}
+
+	// the blocks of critical edges, placed after the block the edge leaves
+	std::vector<std::vector<BasicBlock>> edge_blocks(num_blocks);
+	std::vector<std::pair<ValueId, ValueId>> copies;
+	std::vector<bool> is_written(fn.values.size());
+	std::size_t lowered = 0;
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		auto& bb = fn.blocks[block];
+		const std::size_t first = !bb.inst.empty() && bb.inst.front().opcode == Opcode::Label;
+		const auto end = after_phis(bb);
+		if (first == end) continue;
+
+		for (std::size_t edge = 0; edge < bb.predecessors.size(); ++edge) {
+			copies.clear();
+			for (auto i = first; i < end; ++i) {
+				const auto src = bb.inst[i].operands(fn.extra_operands)[edge];
+				if (src != bb.inst[i].result) copies.push_back({ bb.inst[i].result, src });
+			}
+			if (copies.empty()) continue;
+			is_written.resize(fn.values.size());
+
+			const auto pred = bb.predecessors[edge];
+			auto& pred_bb = fn.blocks[pred];
+			if (pred_bb.successors.size() == 1) {
+				// a source computed for the phi alone is computed into it instead,
+				// when nothing reads the phi after that. Constants keep their copy,
+				// their value belongs to the value they write.
+				const auto reads = [&](const Inst& ins, const ValueId value) {
+					const auto used = ins.used_values(fn.extra_operands);
+					return std::find(used.begin(), used.end(), value) != used.end();
+				};
+				for (std::size_t i = 0; i < copies.size();) {
+					const auto [dst, src] = copies[i];
+					const auto def = std::find_if(pred_bb.inst.begin() + static_cast<std::ptrdiff_t>(after_phis(pred_bb)), pred_bb.inst.end(), [&](const Inst& ins) {
+						return ins.result == src;
+					});
+					const bool coalesce = uses[src] == 1 && def != pred_bb.inst.end() &&
+						def->opcode != Opcode::Const && def->opcode != Opcode::Alloc &&
+						std::none_of(def + 1, pred_bb.inst.end(), [&](const Inst& ins) { return reads(ins, dst); }) &&
+						std::none_of(copies.begin(), copies.end(), [&](const auto& other) { return other.second == dst; });
+					if (!coalesce) {
+						++i;
+						continue;
+					}
+					def->result = dst;
+					copies.erase(copies.begin() + static_cast<std::ptrdiff_t>(i));
+				}
+				if (copies.empty()) continue;
+				auto position = pred_bb.inst.size();
+				if (position && pred_bb.inst.back().is_block_terminator()) --position;
+				push_parallel_copies(fn, pred_bb.inst, position, copies, is_written);
+				continue;
+			}
+
+			// the copies of an edge from a block going elsewhere too get a block of their own,
+			// the branch label of the edge is the one of the same place among the edges to the block
+			const auto nth = std::count(bb.predecessors.begin(), bb.predecessors.begin() + static_cast<std::ptrdiff_t>(edge), pred);
+			std::ptrdiff_t seen = 0;
+			std::size_t successor = 0;
+			while (pred_bb.successors[successor] != block || seen++ != nth) ++successor;
+			auto& branch = pred_bb.inst.back();
+			if (branch.opcode != Opcode::Branch) throw std::runtime_error("internal error: a block with several successors does not end in a branch");
+			const auto edge_label = next_label++;
+			branch.storage[1 + successor] = edge_label;
+
+			BasicBlock edge_bb{ .lbl_entry = edge_label };
+			edge_bb.inst.push_back(Inst::make(Opcode::Label, NoValue, { edge_label }));
+			push_parallel_copies(fn, edge_bb.inst, 1, copies, is_written);
+			// a branch jumps to the label of the block
+			edge_bb.inst.push_back(Inst::make(Opcode::Jump, NoValue, { bb.inst.front().operand(0) }));
+			edge_blocks[pred].push_back(std::move(edge_bb));
+		}
+		lowered += end - first;
+		bb.inst.erase(bb.inst.begin() + static_cast<std::ptrdiff_t>(first), bb.inst.begin() + static_cast<std::ptrdiff_t>(end));
+	}
+
+	std::vector<BasicBlock> blocks;
+	for (BlockId block = 0; block < num_blocks; ++block) {
+		blocks.push_back(std::move(fn.blocks[block]));
+		blocks.back().successors.clear();
+		blocks.back().predecessors.clear();
+		for (auto& edge_bb : edge_blocks[block]) {
+			blocks.push_back(std::move(edge_bb));
+		}
+	}
+	fn.blocks = std::move(blocks);
+
+	std::unordered_map<LabelId, BlockId> label_blocks;
+	for (BlockId block = 0; block < fn.blocks.size(); ++block) {
+		const auto& inst = fn.blocks[block].inst;
+		if (!inst.empty() && inst.front().opcode == Opcode::Label) label_blocks.emplace(inst.front().operand(0), block);
+	}
+	link_blocks(fn, [&](const LabelId label) { return label_blocks.at(label); });
+	return lowered;
+}
+
+std::size_t lower_phis(Module& mod) {
+	// labels are unique across the module, like the ones IRGen gives out
+	LabelId next_label = 0;
+	for (const auto& [name, fn] : mod.functions) {
+		for (const auto& bb : fn.blocks) {
+			next_label = std::max(next_label, bb.lbl_entry + 1);
+			for (const auto& ins : bb.inst) {
+				if (ins.opcode == Opcode::Label) next_label = std::max(next_label, ins.operand(0) + 1);
+			}
+		}
+	}
+	std::size_t lowered = 0;
+	for (auto& [name, fn] : mod.functions) {
+		lowered += lower_function_phis(fn, next_label);
+	}
+	return lowered;
+}
+
+void register_ir_passes(FunctionPassManager& passes, const std::size_t max_eval_steps) {
+	passes.register_pass({
+		.name = "remove-unreachable",
+		.required = analysis_set(Analysis::CFGOrder),
+		.run = remove_unreachable_blocks });
+	passes.register_pass({
+		.name = "evaluate",
+		.run = [max_eval_steps](CFGFunction& fn, FunctionAnalyses& analyses) {
+			return fold_evaluated_function(fn, analyses, max_eval_steps);
+		} });
+	passes.register_pass({
+		.name = "fold-constants",
+		.required = analysis_set(Analysis::CFGOrder),
+		.run = fold_constants });
+	passes.register_pass({
+		.name = "mem2reg",
+		.required = analysis_set(Analysis::Dominators) | analysis_set(Analysis::DominanceFrontiers) | analysis_set(Analysis::Liveness),
+		.preserved = analysis_set(Analysis::CFGOrder) | analysis_set(Analysis::Dominators) | analysis_set(Analysis::DominanceFrontiers) | analysis_set(Analysis::Loops),
+		.run = promote_variables });
+}
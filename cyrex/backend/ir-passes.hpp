@@ -0,0 +1,31 @@
+#pragma once
+#include "analysis.hpp"
+#include "ir-interpreter.hpp"
+
+// Drops blocks the entry cannot reach. The last block, which every
+// return jumps to, is always kept.
+std::size_t remove_unreachable_blocks(CFGFunction& fn, FunctionAnalyses& analyses);
+
+// Replaces a function the interpreter runs to its return within max_steps
+// with a return of the constant it returned.
+std::size_t fold_evaluated_function(CFGFunction& fn, FunctionAnalyses& analyses, std::size_t max_steps);
+
+// Replaces instructions of two constants with the constant they compute,
+// and branches on a constant with a jump. The blocks no longer jumped to
+// stay for remove-unreachable.
+std::size_t fold_constants(CFGFunction& fn, FunctionAnalyses& analyses);
+
+// Turns the variables of a function, the values stored to or written more
+// than once, into values written once, with phis where the writes of
+// different paths meet, pruned to where the variable is live. Nothing takes
+// the address of a variable, so every one of them is promoted.
+std::size_t promote_variables(CFGFunction& fn, FunctionAnalyses& analyses);
+
+// Replaces the phis of every function with copies at the end of the blocks
+// before them, the backend has no phis. Edges from blocks going elsewhere
+// too get a block of their own for their copies.
+std::size_t lower_phis(Module& mod);
+
+// Makes every pass above but lower_phis available to pipelines, max_eval_steps is the
+// budget of evaluate
+void register_ir_passes(FunctionPassManager& passes, std::size_t max_eval_steps = default_eval_steps);
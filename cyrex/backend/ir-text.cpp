@@ -0,0 +1,375 @@
+#include "ir-text.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <format>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+std::string type_name(const AST::Type& type) {
+	std::string s(type.name);
+	for (const auto& qual : type.qualifiers()) {
+		if (qual.kind == AST::Type::Qualifier::Kind::Pointer) {
+			s += '*';
+		} else {
+			s += std::format("[{}]", qual.array_length);
+		}
+		if (qual.is_const) {
+			s += " const";
+		}
+	}
+	return s;
+}
+
+static void print_instruction(std::ostream& os, const Inst& ins, const CFGFunction& fn, const TypeContext& types) {
+	if (ins.opcode == Opcode::Label) {
+		os << std::format("L{}:\n", ins.operand(0));
+		return;
+	}
+
+	if (ins.opcode == Opcode::Branch) {
+		os << std::format("b v{}, L{}, L{}\n", ins.operand(0), ins.operand(1), ins.operand(2));
+		return;
+	}
+
+	if (ins.opcode == Opcode::Jump) {
+		os << std::format("j L{}\n", ins.operand(0));
+		return;
+	}
+
+	// Result + type
+	if (ins.result >= 0) {
+		os << std::format("v{} : {} = ", ins.result, type_name(types.type(fn.values[ins.result].type)));
+	}
+	os << opcode_name(ins.opcode);
+	// Special case: const  print literal value
+	if (ins.opcode == Opcode::Const) {
+		os << ' ';
+		std::visit([&](auto&& x) {
+			os << x;
+		}, fn.literal(ins.result).data);
+	}
+	const auto operands = ins.operands(fn.extra_operands);
+	for (std::size_t i = 0; i < operands.size(); ++i) {
+		os << (i ? ", " : " ") << std::format("v{}", operands[i]);
+	}
+	os << '\n';
+}
+
+void print_ir(std::ostream& os, const Module& mod) {
+	for (const auto& [name, fn] : mod.functions) {
+		os << std::format("function {}:\n", name);
+		for (const auto& blk : fn.blocks) {
+			os << std::format("BB{}:\n", blk.lbl_entry);
+			for (const auto& ins : blk.inst) {
+				print_instruction(os, ins, fn, mod.types);
+			}
+		}
+	}
+}
+
+// Reads the text one line at a time, a line is a header or an instruction
+class IRTextReader {
+public:
+	IRTextReader(const std::string_view text, const std::string_view filename) : text(text), filename(filename) {}
+
+	Module read() {
+		while (next_line()) {
+			if (rest.empty() || rest.starts_with(';')) continue;
+			if (accept("function ")) {
+				function_header();
+			} else if (accept("BB")) {
+				block_header();
+			} else {
+				instruction();
+			}
+		}
+		finish_function();
+		return std::move(mod);
+	}
+
+private:
+	bool next_line() {
+		if (pos >= text.size()) return false;
+		const auto end = std::min(text.find('\n', pos), text.size());
+		rest = text.substr(pos, end - pos);
+		if (rest.ends_with('\r')) rest.remove_suffix(1);
+		pos = end + 1;
+		++line_number;
+		skip_space();
+		return true;
+	}
+
+	[[noreturn]] void error(const std::string& message) const {
+		throw std::runtime_error(std::format("{}:{}: {}", filename, line_number, message));
+	}
+
+	void skip_space() {
+		while (!rest.empty() && (rest.front() == ' ' || rest.front() == '\t')) rest.remove_prefix(1);
+	}
+
+	bool accept(const std::string_view token) {
+		if (!rest.starts_with(token)) return false;
+		rest.remove_prefix(token.size());
+		skip_space();
+		return true;
+	}
+
+	void expect(const std::string_view token) {
+		if (!accept(token)) error(std::format("expected '{}'", token));
+	}
+
+	void expect_end() {
+		if (!rest.empty()) error(std::format("unexpected '{}'", rest));
+	}
+
+	std::string_view identifier() {
+		std::size_t n = 0;
+		while (n < rest.size() && (std::isalnum(static_cast<unsigned char>(rest[n])) || rest[n] == '_')) ++n;
+		if (!n) error("expected a name");
+		const auto name = rest.substr(0, n);
+		rest.remove_prefix(n);
+		skip_space();
+		return name;
+	}
+
+	std::int64_t integer() {
+		std::int64_t number{};
+		const auto [end, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), number);
+		if (ec == std::errc::result_out_of_range) error("number out of range");
+		if (ec != std::errc{}) error("expected a number");
+		rest.remove_prefix(end - rest.data());
+		skip_space();
+		return number;
+	}
+
+	LabelId label() {
+		const auto id = integer();
+		if (id < 0 || id > std::numeric_limits<LabelId>::max()) error(std::format("invalid label L{}", id));
+		return static_cast<LabelId>(id);
+	}
+
+	// v-1 is NoValue
+	ValueId value() {
+		expect("v");
+		const auto id = integer();
+		if (id == NoValue) return NoValue;
+		// every value is defined on a line of its own, so larger ids cannot be valid
+		if (id < 0 || static_cast<std::uint64_t>(id) >= text.size()) error(std::format("invalid value v{}", id));
+		if (static_cast<std::size_t>(id) >= fn->values.size()) {
+			fn->values.resize(id + 1);
+			defined.resize(id + 1);
+			first_use.resize(id + 1);
+		}
+		return static_cast<ValueId>(id);
+	}
+
+	ValueId use(const ValueId id) {
+		if (id != NoValue && !first_use[id]) first_use[id] = line_number;
+		return id;
+	}
+
+	TypeId type() {
+		AST::Type type{ .name = identifier() };
+		while (rest.starts_with('*') || rest.starts_with('[')) {
+			AST::Type::Qualifier qual{};
+			if (accept("*")) {
+				qual.kind = AST::Type::Qualifier::Kind::Pointer;
+			} else {
+				expect("[");
+				const auto length = integer();
+				if (length < 0 || length > std::numeric_limits<int>::max()) error("invalid array length");
+				qual.kind = AST::Type::Qualifier::Kind::Array;
+				qual.array_length = static_cast<int>(length);
+				expect("]");
+			}
+			qual.is_const = accept("const");
+			if (!type.add_qualifier(qual)) error("too many type qualifiers");
+		}
+		return mod.types.intern(type);
+	}
+
+	void function_header() {
+		const auto name = identifier();
+		expect(":");
+		expect_end();
+		finish_function();
+		if (mod.functions.contains(std::string(name))) error(std::format("function {} is defined twice", name));
+		fn_name = name;
+		fn = &mod.functions[std::string(name)];
+	}
+
+	void block_header() {
+		if (!fn) error("block outside of a function");
+		const auto label = this->label();
+		expect(":");
+		expect_end();
+		fn->blocks.push_back({ .lbl_entry = label });
+	}
+
+	void instruction() {
+		if (!fn || fn->blocks.empty()) error("instruction outside of a block");
+		const auto block = static_cast<BlockId>(fn->blocks.size() - 1);
+		auto& inst = fn->blocks[block].inst;
+		if (!inst.empty() && inst.back().is_block_terminator()) error("instruction after the end of a block");
+
+		if (accept("L")) {
+			const auto label = this->label();
+			expect(":");
+			expect_end();
+			if (!label_blocks.emplace(label, block).second) error(std::format("label L{} is placed twice", label));
+			// the backend finds the epilogue by the number of its header
+			const auto header = fn->blocks[block].lbl_entry;
+			if (inst.empty() && label != header) error(std::format("block BB{} starts with L{}, its label must be L{}", header, label, header));
+			inst.push_back(Inst::make(Opcode::Label, NoValue, { label }));
+			return;
+		}
+
+		ValueId result = NoValue;
+		TypeId type{};
+		if (rest.starts_with('v')) {
+			result = value();
+			if (result == NoValue) error("v-1 cannot be a result");
+			expect(":");
+			type = this->type();
+			expect("=");
+		}
+
+		const auto name = identifier();
+		const auto opcode = find_opcode(name);
+		if (result != NoValue) {
+			define(result, type);
+		}
+		// a store writes its first operand instead
+		const bool has_result = opcode != Opcode::Store && opcode != Opcode::Return;
+		if (opcode != Opcode::Branch && opcode != Opcode::Jump && has_result != (result != NoValue)) {
+			error(std::format(has_result ? "{} needs a result" : "{} has no result", name));
+		}
+
+		if (opcode == Opcode::Branch || opcode == Opcode::Jump) {
+			if (result != NoValue) error(std::format("{} has no result", name));
+			if (opcode == Opcode::Jump) {
+				expect("L");
+				inst.push_back(Inst::make(Opcode::Jump, NoValue, { label() }));
+			} else {
+				const auto condition = use(value());
+				if (condition == NoValue) error("b cannot read v-1");
+				expect(",");
+				expect("L");
+				const auto l_true = label();
+				expect(",");
+				expect("L");
+				inst.push_back(Inst::make(Opcode::Branch, NoValue, { condition, l_true, label() }));
+			}
+			expect_end();
+			return;
+		}
+
+		if (opcode == Opcode::Const) {
+			fn->values[result].literal = static_cast<std::uint32_t>(fn->literals.size());
+			fn->literals.push_back({ static_cast<long>(integer()) });
+		}
+
+		if (opcode == Opcode::Phi) {
+			if (std::any_of(inst.begin(), inst.end(), [](const Inst& ins) { return ins.opcode != Opcode::Label && ins.opcode != Opcode::Phi; })) {
+				error("phi after the start of a block");
+			}
+		}
+
+		operands.clear();
+		if (!rest.empty()) {
+			do {
+				operands.push_back(use(value()));
+				// only a return of nothing reads no value
+				if (operands.back() == NoValue && opcode != Opcode::Return) error(std::format("{} cannot read v-1", name));
+			} while (accept(","));
+		}
+		expect_end();
+		// a bare ret returns nothing, like the ret v-1 the text is written with
+		if (opcode == Opcode::Return && operands.empty()) operands.push_back(NoValue);
+		const auto [min_operands, max_operands] = operand_counts(opcode);
+		if (operands.size() < min_operands || operands.size() > max_operands) {
+			error(min_operands == max_operands
+				? std::format("{} takes {} operand{}, not {}", name, min_operands, min_operands == 1 ? "" : "s", operands.size())
+				: std::format("{} takes {} to {} operands, not {}", name, min_operands, max_operands, operands.size()));
+		}
+		inst.push_back(Inst::make(opcode, result, operands, fn->extra_operands));
+	}
+
+	Opcode find_opcode(const std::string_view name) const {
+		for (auto i = 0; i <= static_cast<int>(Opcode::Phi); ++i) {
+			const auto opcode = static_cast<Opcode>(i);
+			if (opcode != Opcode::Label && name == opcode_name(opcode)) return opcode;
+		}
+		error(std::format("unknown instruction '{}'", name));
+	}
+
+	void define(const ValueId id, const TypeId type) {
+		// values may be defined on several paths, such as the result of an if expression
+		if (defined[id] && fn->values[id].type != type) error(std::format("v{} is redefined with another type", id));
+		fn->values[id].type = type;
+		defined[id] = true;
+	}
+
+	void finish_function() {
+		if (!fn) return;
+		if (fn->blocks.empty()) throw std::runtime_error(std::format("{}: function {} has no blocks", filename, fn_name));
+		// returns jump to the last block, the epilogue the backend writes the return of
+		const auto& epilogue = fn->blocks.back();
+		if (std::any_of(epilogue.inst.begin(), epilogue.inst.end(), [](const Inst& ins) { return ins.opcode != Opcode::Label; })) {
+			throw std::runtime_error(std::format("{}: the last block of function {}, BB{}, must hold only its label, returns jump to it",
+				filename, fn_name, epilogue.lbl_entry));
+		}
+		// ids that are neither used nor defined keep TypeId 0, nothing refers to them
+		for (std::size_t id = 0; id < defined.size(); ++id) {
+			if (first_use[id] && !defined[id]) {
+				line_number = first_use[id];
+				error(std::format("v{} is never defined", id));
+			}
+		}
+
+		link_blocks(*fn, [this](const LabelId label) {
+			const auto it = label_blocks.find(label);
+			if (it == label_blocks.end()) {
+				throw std::runtime_error(std::format("{}: function {} jumps to L{}, which is never placed", filename, fn_name, label));
+			}
+			return it->second;
+		});
+		for (const auto& bb : fn->blocks) {
+			for (const auto& ins : bb.inst) {
+				if (ins.opcode == Opcode::Phi && ins.num_operands != bb.predecessors.size()) {
+					throw std::runtime_error(std::format("{}: a phi of BB{} in function {} has {} operands for {} predecessors",
+						filename, bb.lbl_entry, fn_name, ins.num_operands, bb.predecessors.size()));
+				}
+			}
+		}
+
+		fn = nullptr;
+		defined.clear();
+		first_use.clear();
+		label_blocks.clear();
+	}
+
+private:
+	std::string_view text;
+	std::string_view filename;
+	std::size_t pos = 0;
+	std::size_t line_number = 0;
+	// the unread part of the current line
+	std::string_view rest;
+
+	Module mod;
+	CFGFunction* fn = nullptr;
+	std::string_view fn_name;
+	// per value of the current function
+	std::vector<bool> defined;
+	// line of the first use, 0 for values never used
+	std::vector<std::size_t> first_use;
+	std::unordered_map<LabelId, BlockId> label_blocks;
+	std::vector<ValueId> operands;
+};
+
+Module read_ir(const std::string_view text, const std::string_view filename) {
+	return IRTextReader(text, filename).read();
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "ir.hpp"
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// The textual IR written by --ir. Every function starts with a
+// "function name:" line followed by its blocks, one instruction a line:
+//   BB0:
+//   L0:
+//   v0 : int = const 5
+//   b v0, L2, L3
+// Block edges are not written, they follow from the terminators. The last
+// block of a function holds only its label: every ret jumps to it, and the
+// backend writes the return there.
+
+// a type as the text spells it, qualifiers follow the name: int*[4] const
+std::string type_name(const AST::Type& type);
+
+void print_ir(std::ostream& os, const Module& mod);
+
+// Builds a module from the textual IR, filename is only used in errors.
+// Errors throw a runtime_error naming the line.
+Module read_ir(std::string_view text, std::string_view filename);
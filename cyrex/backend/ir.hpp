@@ -1,23 +1,38 @@
 #pragma once
 // TODO: separate AST from IR
 #include "frontend/ast.hpp"
+#include "type-context.hpp"
 #include <unordered_map>
+#include <map>
+#include <variant>
+#include <array>
+#include <algorithm>
+#include <span>
+#include <initializer_list>
+#include <utility>
+#include <type_traits>
+#include <cstdint>
+#include <stdexcept>
+#include <limits>
 
 using ValueId = int;
 using LabelId = ValueId;
 
 constexpr static ValueId NoValue = -1;
 
+constexpr static std::uint32_t NoLiteral = ~std::uint32_t{};
+
 struct Value {
-	// TODO: language independent type
-	AST::Type type;
+	TypeId type;
+	// index into the literals of the function, for constants
+	std::uint32_t literal = NoLiteral;
 };
 
 struct Literal {
 	std::variant<long /*, double, std::string*/> data;
 };
 
-enum class Opcode {
+enum class Opcode : std::uint8_t {
 	// Storage
 	Alloc,
 	Const,
@@ -41,6 +56,10 @@ enum class Opcode {
 	Branch,
 	Jump,
 	Return,
+	// SSA
+	// an operand per predecessor of its block, in the order of its predecessors.
+	// Phis come first in their block, after its label.
+	Phi,
 };
 
 constexpr const char* opcode_name(const Opcode opcode) {
@@ -64,13 +83,91 @@ constexpr const char* opcode_name(const Opcode opcode) {
 		case Opcode::Branch: return "b";
 		case Opcode::Jump: return "j";
 		case Opcode::Return: return "ret";
+		case Opcode::Phi: return "phi";
+	}
+}
+
+// the fewest and most operands of an instruction, phis read one per
+// predecessor and a return of nothing reads NoValue
+constexpr std::pair<std::size_t, std::size_t> operand_counts(const Opcode opcode) {
+	using enum Opcode;
+	switch (opcode) {
+		case Alloc:
+		case Const: return { 0, 0 };
+		case Load:
+		case Label:
+		case Jump:
+		case Return: return { 1, 1 };
+		case Branch: return { 3, 3 };
+		case Phi: return { 0, std::numeric_limits<std::uint16_t>::max() };
+		default: return { 2, 2 };
 	}
 }
 
+// Operands are stored inline. Instructions with more of them keep their
+// operands in the extra operands of their function instead.
 struct Inst {
-	Opcode opcode;
-	ValueId result;
-	std::vector<ValueId> operands;
+	constexpr static std::size_t max_inline_operands = 3;
+
+	Opcode opcode{};
+	std::uint16_t num_operands{};
+	ValueId result = NoValue;
+	// the operands, or the offset of the operands into the extra operands
+	std::array<ValueId, max_inline_operands> storage{};
+
+	// an instruction whose operands fit inline
+	static Inst make(const Opcode opcode, const ValueId result, const std::initializer_list<ValueId> operands) {
+		if (operands.size() > max_inline_operands) throw std::runtime_error("internal error: too many operands for an inline instruction");
+		Inst inst{ .opcode = opcode, .num_operands = static_cast<std::uint16_t>(operands.size()), .result = result };
+		std::copy(operands.begin(), operands.end(), inst.storage.begin());
+		return inst;
+	}
+
+	// an instruction with any number of operands, extra is the extra operands of its function
+	static Inst make(const Opcode opcode, const ValueId result, const std::span<const ValueId> operands, std::vector<ValueId>& extra) {
+		Inst inst{ .opcode = opcode, .num_operands = static_cast<std::uint16_t>(operands.size()), .result = result };
+		if (inst.is_inline()) {
+			std::copy(operands.begin(), operands.end(), inst.storage.begin());
+		} else {
+			inst.storage[0] = static_cast<ValueId>(extra.size());
+			extra.insert(extra.end(), operands.begin(), operands.end());
+		}
+		return inst;
+	}
+
+	constexpr bool is_inline() const { return num_operands <= max_inline_operands; }
+
+	// operand of an instruction with a fixed number of operands
+	constexpr ValueId operand(const std::size_t index) const {
+		if (!is_inline()) throw std::runtime_error("internal error: operand of an instruction with extra operands");
+		return storage[index];
+	}
+
+	std::span<const ValueId> operands(const std::span<const ValueId> extra) const {
+		if (is_inline()) return { storage.data(), num_operands };
+		return extra.subspan(storage[0], num_operands);
+	}
+	std::span<ValueId> operands(const std::span<ValueId> extra) {
+		if (is_inline()) return { storage.data(), num_operands };
+		return extra.subspan(storage[0], num_operands);
+	}
+
+	// the values an instruction reads, label operands are not values.
+	// A phi reads its operands on the edges into its block, analyses count
+	// them as read in the block.
+	std::span<const ValueId> used_values(const std::span<const ValueId> extra) const {
+		const auto [first, count] = used_range();
+		return operands(extra).subspan(first, count);
+	}
+	std::span<ValueId> used_values(const std::span<ValueId> extra) {
+		const auto [first, count] = used_range();
+		return operands(extra).subspan(first, count);
+	}
+
+	// the value an instruction writes, a store writes the variable it stores to
+	constexpr ValueId written_value() const {
+		return opcode == Opcode::Store ? operand(0) : result;
+	}
 
 	constexpr auto is_block_terminator() const {
 		using enum Opcode;
@@ -82,28 +179,74 @@ struct Inst {
 		}
 		return false;
 	}
+
+private:
+	// the position and number of the operands used_values returns
+	constexpr std::pair<std::size_t, std::size_t> used_range() const {
+		switch (opcode) {
+			case Opcode::Store: return { 1, 1 };
+			case Opcode::Branch: return { 0, 1 };
+			case Opcode::Label:
+			case Opcode::Jump: return { 0, 0 };
+			case Opcode::Return: return { 0, storage[0] == NoValue ? 0 : 1 };
+			default: return { 0, num_operands };
+		}
+	}
 };
+static_assert(std::is_trivially_copyable_v<Inst>);
 
 
-struct LinearFunction {
-	LabelId pro_lbl{};
-	LabelId epi_lbl{};
-	std::vector<Value> values;
-	std::vector<Inst> insts;
-	std::unordered_map<std::string, ValueId> locals;
-};
+// Index of a block within its function
+using BlockId = std::uint32_t;
+constexpr static BlockId NoBlock = ~BlockId{};
 
 struct BasicBlock {
 	LabelId lbl_entry;
 	std::vector<Inst> inst;
-	std::vector<BasicBlock*> successors;
+	std::vector<BlockId> successors;
+	std::vector<BlockId> predecessors;
 };
 
 struct CFGFunction {
+	// values are numbered from 0 in every function
 	std::vector<Value> values;
+	std::vector<Literal> literals;
+	std::vector<ValueId> extra_operands;
+	// the entry block is first, the block every return jumps to is last
 	std::vector<BasicBlock> blocks;
+
+	bool is_literal(const ValueId id) const { return values[id].literal != NoLiteral; }
+	const Literal& literal(const ValueId id) const { return literals[values[id].literal]; }
 };
 
+// Adds the edges of every block from its terminator. block_of maps a label
+// to the block it starts, returns go to the last block.
+template <typename BlockOf>
+void link_blocks(CFGFunction& fn, BlockOf&& block_of) {
+	auto& blocks = fn.blocks;
+	if (blocks.empty()) return;
+	const BlockId epilogue = static_cast<BlockId>(blocks.size() - 1);
+	for (BlockId i = 0; i < blocks.size(); ++i) {
+		auto& bb = blocks[i];
+		if (bb.inst.empty()) continue;
+		const auto& ins = bb.inst.back();
+		switch (ins.opcode) {
+			case Opcode::Jump: bb.successors.push_back(block_of(ins.operand(0))); break;
+			case Opcode::Branch:
+			bb.successors.push_back(block_of(ins.operand(1)));
+			bb.successors.push_back(block_of(ins.operand(2)));
+			break;
+			case Opcode::Return: bb.successors.push_back(epilogue); break;
+			default: break;
+		}
+		for (const auto succ : bb.successors) {
+			blocks[succ].predecessors.push_back(i);
+		}
+	}
+}
+
 struct Module {
-	std::unordered_map<std::string, CFGFunction> functions;
+	TypeContext types;
+	// ordered by name, so output does not depend on hashing
+	std::map<std::string, CFGFunction> functions;
 };
@@ -3,106 +3,67 @@
 #include <iostream>
 #include <format>
 
-template<class ...Ts>
-struct overloaded : Ts... { using Ts::operator()...; };
-
-ValueId IRGen::gen(const AST::Ptr& ptr) {
-	auto visitor = overloaded{
-		[&](const AST::Top& x) { return top(x); },
-		[&](const AST::Stmt& x) { return stmt(x); },
-		[&](const AST::Expr& x) { return expr(x); }
-	};
-	return std::visit(visitor, ptr->data);
-}
-
-const Value& IRGen::get_value_by_id(const ValueId value_id) const {
-	return values.at(value_id);
-}
-
-const Literal& IRGen::get_literal_by_id(const ValueId value_id) const {
-	return literals.at(value_id);
-}
-
-const CFGFunction& IRGen::get_function_by_name(const std::string& name) const {
-	return mod.functions.at(name);
-}
-
-bool IRGen::literal_exists(const ValueId value_id) const {
-	return literals.contains(value_id);
-}
-
-ValueId IRGen::top(const AST::Top& top) {
-	auto visitor = overloaded{
-		[&](const AST::Root& x) { return root(x); },
-		[&](const AST::Function& x) { return function(x); },
-		[&](const AST::ParameterList& x) { return parameter_list(x); }
-	};
-	return std::visit(visitor, top);
+IRGen::IRGen(const Interner& interner) : interner(interner) {}
+
+ValueId IRGen::gen(const AST::NodeId id) {
+	using enum AST::Kind;
+	switch (tree->kind(id)) {
+		case None: return NoValue;
+		// top
+		case Function: return function(tree->get<AST::Function>(id));
+		case ParameterList: return parameter_list(tree->get<AST::ParameterList>(id));
+		// statements
+		case IfStmt: return if_stmt(tree->get<AST::IfStmt>(id));
+		case WhileStmt: return while_stmt(tree->get<AST::WhileStmt>(id));
+		case BlockStmt: return block_stmt(tree->get<AST::BlockStmt>(id));
+		case ReturnStmt: return return_stmt(tree->get<AST::ReturnStmt>(id));
+		case VariableStmt: return var_stmt(tree->get<AST::VariableStmt>(id));
+		// expressions
+		case LiteralExpr: return literal_expr(tree->get<AST::LiteralExpr>(id));
+		case IfExpr: return if_expr(tree->get<AST::IfExpr>(id));
+		case WhileExpr: return while_expr(tree->get<AST::WhileExpr>(id));
+		case BinaryExpr: return binary_expr(tree->get<AST::BinaryExpr>(id));
+		case AssignExpr: return assign_expr(tree->get<AST::AssignExpr>(id));
+		case IdentifierExpr: return identifier_expr(tree->get<AST::IdentifierExpr>(id));
+		case TupleExpr: return NoValue;
+		case TupleAssignExpr: return NoValue;
+	}
+	throw std::runtime_error("internal error: unknown AST node kind");
 }
 
-ValueId IRGen::root(const AST::Root& root) {
+void IRGen::gen(const AST::Root& root) {
 	for (const auto& fn : root.functions) {
-		gen(fn);
-	}
-
-	for (const auto& [fn_name, fn] : functions) {
-		auto blocks = bbg.function(fn);
-		bbg.link_blocks(blocks, fn);
-		bbg.fn_to_bbs[fn_name] = blocks;
-	}
-
-	// Generate basic blocks
-	for (const auto& [fn_name, fn] : functions) {
-		const auto& bbs = bbg.fn_to_bbs.at(fn_name);
-		auto& mf = mod.functions[fn_name];
-		mf.blocks = bbs;
-		mf.values = fn.values;
+		tree = &fn;
+		gen(fn.root());
 	}
-
-	return NoValue;
-}
-
-ValueId IRGen::stmt(const AST::Stmt& stmt) {
-	auto visitor = overloaded{
-		[&](const AST::IfStmt& x) { return if_stmt(x); },
-		[&](const AST::WhileStmt& x) { return while_stmt(x); },
-		[&](const AST::BlockStmt& x) { return block_stmt(x); },
-		[&](const AST::ReturnStmt& x) { return return_stmt(x); },
-		[&](const AST::VariableStmt& x) { return var_stmt(x); }
-	};
-	return std::visit(visitor, stmt);
-}
-
-ValueId IRGen::expr(const AST::Expr& expr) {
-	auto visitor = overloaded{
-		[&](const AST::LiteralExpr& x) { return literal_expr(x); },
-		[&](const AST::IfExpr& x) { return if_expr(x);  },
-		[&](const AST::WhileExpr& x) { return while_expr(x);  },
-		[&](const AST::BinaryExpr& x) { return binary_expr(x);  },
-		[&](const AST::AssignExpr& x) { return assign_expr(x);  },
-		[&](const AST::IdentifierExpr& x) {return identifier_expr(x); },
-		[&](const AST::TupleExpr& x) { return NoValue;  },
-		[&](const AST::TupleAssignExpr& x) { return NoValue;  },
-	};
-	return std::visit(visitor, expr);
+	tree = nullptr;
 }
 
 ValueId IRGen::function(const AST::Function& function) {
-	if (mod.functions.contains(function.name)) {
-		push_error(std::format("function {} is already defined", function.name));
+	const std::string name(interner.spelling(function.name));
+	if (mod.functions.contains(name)) {
+		push_error(std::format("function {} is already defined", name));
 		return NoValue;
 	}
-	current_fn = &functions[function.name];
-	current_fn->pro_lbl = new_label();
-	push_label(current_fn->pro_lbl);
-	current_fn->epi_lbl = new_label();
+	current_fn = &mod.functions[name];
+	current_block = NoBlock;
+	slot_values.assign(function.num_slots, NoValue);
+	first_label = next_label_id;
+	label_blocks.clear();
+
+	push_label(new_label());
+	epilogue_label = new_label();
 	gen(function.block);
-	push_label(current_fn->epi_lbl);
+	push_label(epilogue_label);
+	// labels may be used before they are placed, so edges are added last
+	link_blocks(*current_fn, [this](const LabelId label) { return block_of(label); });
+
+	current_fn = nullptr;
 	return NoValue;
 }
 
 ValueId IRGen::parameter_list(const AST::ParameterList& parameter_list) {
-	for (const auto& param : parameter_list.items) {
+	for (const auto param : tree->list(parameter_list.items)) {
 		gen(param);
 	}
 	return NoValue;
@@ -151,11 +112,9 @@ ValueId IRGen::while_stmt(const AST::WhileStmt& while_stmt) {
 }
 
 ValueId IRGen::block_stmt(const AST::BlockStmt& block) {
-	enter_scope();
-	for (const auto& stmt : block.statements) {
+	for (const auto stmt : tree->list(block.statements)) {
 		gen(stmt);
 	}
-	exit_scope();
 	return NoValue;
 }
 
@@ -169,14 +128,10 @@ ValueId IRGen::return_stmt(const AST::ReturnStmt& ret) {
 }
 
 ValueId IRGen::var_stmt(const AST::VariableStmt& var) {
-	auto& syms = scopes.back().symbols;
+	// every use was replaced by the constant
+	if (var.is_folded) return NoValue;
 
-	if (syms.contains(var.name)) {
-		push_error(std::format("variable {} already defined in scope", var.name));
-		return NoValue;
-	}
-
-	ValueId vid = new_value(var.type);
+	ValueId vid = new_value(mod.types.intern(var.type));
 	push_inst(Opcode::Alloc, vid);
 
 	if (var.initializer) {
@@ -184,7 +139,7 @@ ValueId IRGen::var_stmt(const AST::VariableStmt& var) {
 		push_inst(Opcode::Store, NoValue, { vid, init });
 	}
 
-	syms[var.name] = vid;
+	slot_values[var.sym.slot] = vid;
 	return NoValue;
 }
 
@@ -198,7 +153,7 @@ ValueId IRGen::if_expr(const AST::IfExpr& if_expr) {
 
 	push_label(l_true);
 	ValueId val_iftrue = gen(if_expr.then_expr);
-	ValueId result = new_value(values[val_iftrue].type);
+	ValueId result = new_value(current_fn->values[val_iftrue].type);
 	push_inst(Opcode::Load, result, { val_iftrue });
 	push_inst(Opcode::Jump, NoValue, { l_done });
 
@@ -232,25 +187,41 @@ ValueId IRGen::while_expr(const AST::WhileExpr& while_expr) {
 }
 
 ValueId IRGen::literal_expr(const AST::LiteralExpr& literal) {
-	ValueId value = new_value(literal.type);
+	ValueId value = new_value(mod.types.intern(literal.type));
 	push_inst(Opcode::Const, value);
-	literals[value] = parse_literal(literal);
+	current_fn->values[value].literal = static_cast<std::uint32_t>(current_fn->literals.size());
+	current_fn->literals.push_back(parse_literal(literal));
 	return value;
 }
 
 ValueId IRGen::identifier_expr(const AST::IdentifierExpr& identifier) {
-	auto maybe_id = find_symbol(identifier.name);
-	if (maybe_id == std::nullopt) {
-		push_error(std::format("symbol {} is undefined", identifier.name));
-		return NoValue;
-	} else {
-		return *maybe_id;
+	// names are resolved by semantic analysis, which rejects uses of parameters
+	const ValueId value = slot_values[identifier.sym.slot];
+	if (value == NoValue) {
+		throw std::runtime_error(std::format("internal error: {} has no value", interner.spelling(identifier.sym.name)));
 	}
+	return value;
 }
 
-ValueId IRGen::binary_expr(const AST::BinaryExpr& binary) {
-	auto left = gen(binary.left);
-	auto res = new_value(values.at(left).type);
+ValueId IRGen::binary_expr(const AST::BinaryExpr& outermost) {
+	// Long chains lean left, so the left spine is walked without recursing
+	// and emitted from the innermost operator outwards.
+	const std::size_t spine_base = spine.size();
+	spine.push_back(&outermost);
+	while (tree->kind(spine.back()->left) == AST::Kind::BinaryExpr) {
+		spine.push_back(&tree->get<AST::BinaryExpr>(spine.back()->left));
+	}
+
+	auto left = gen(spine.back()->left);
+	while (spine.size() > spine_base) {
+		left = binary_op(*spine.back(), left);
+		spine.pop_back();
+	}
+	return left;
+}
+
+ValueId IRGen::binary_op(const AST::BinaryExpr& binary, const ValueId left) {
+	auto res = new_value(current_fn->values[left].type);
 	auto right = gen(binary.right);
 
 	switch (binary.kind) {
@@ -279,10 +250,10 @@ ValueId IRGen::assign_expr(const AST::AssignExpr& assign) {
 
 Literal IRGen::parse_literal(const AST::LiteralExpr literal) {
 	if (literal.type.name == "int") {
-		return { std::stol(literal.value) };
+		return { static_cast<long>(literal.number) };
 	}
 	if (literal.type.name == "long") {
-		return { std::stol(literal.value) };
+		return { static_cast<long>(literal.number) };
 	}
 	if (literal.type.name == "double") {
 		throw "double not implemented";
@@ -300,123 +271,50 @@ void IRGen::push_error(const std::string& error_message) {
 	errors.push_back(error_message);
 }
 
-void IRGen::push_inst(const Opcode o, const ValueId result, const std::vector<ValueId>& operands) {
-	current_fn->insts.emplace_back(o, result, operands);
+void IRGen::push_inst(const Opcode o, const ValueId result, const std::initializer_list<ValueId> operands) {
+	// code after a terminator is unreachable, it gets a block of its own
+	if (is_terminated()) {
+		push_label(new_label());
+	}
+	auto& block = current_fn->blocks[current_block];
+	block.inst.push_back(Inst::make(o, result, { operands.begin(), operands.size() }, current_fn->extra_operands));
 }
 
 void IRGen::push_label(const LabelId label_id) {
-	push_inst(Opcode::Label, NoValue, { label_id });
-}
+	auto& blocks = current_fn->blocks;
+	if (current_block != NoBlock && !is_terminated()) {
+		blocks[current_block].inst.push_back(Inst::make(Opcode::Jump, NoValue, { label_id }));
+	}
 
-ValueId IRGen::new_value(const AST::Type& type) {
-	const auto id = values.size();
-	Value value;
-	value.type = type;
-	values.push_back(value);
-	return id;
+	const std::size_t index = label_id - first_label;
+	if (index >= label_blocks.size()) {
+		label_blocks.resize(index + 1, NoBlock);
+	}
+	current_block = static_cast<BlockId>(blocks.size());
+	label_blocks[index] = current_block;
+	blocks.push_back({ .lbl_entry = label_id });
+	blocks.back().inst.push_back(Inst::make(Opcode::Label, NoValue, { label_id }));
 }
 
-void IRGen::enter_scope() {
-	scopes.emplace_back();
+bool IRGen::is_terminated() const {
+	const auto& inst = current_fn->blocks[current_block].inst;
+	return !inst.empty() && inst.back().is_block_terminator();
 }
 
-std::optional<ValueId> IRGen::find_symbol(const std::string& name) {
-	for (auto it = scopes.rbegin(); it != scopes.rend(); it = std::next(it)) {
-		if (auto s_it = it->symbols.find(name); s_it != it->symbols.end()) {
-			auto& [s_name, s_id] = *s_it;
-			return s_id;
-		}
+BlockId IRGen::block_of(const LabelId label_id) const {
+	const std::size_t index = label_id - first_label;
+	if (index >= label_blocks.size() || label_blocks[index] == NoBlock) {
+		throw std::runtime_error(std::format("internal error: label L{} was never placed", label_id));
 	}
-	return std::nullopt;
+	return label_blocks[index];
 }
 
-void IRGen::exit_scope() {
-	scopes.pop_back();
+ValueId IRGen::new_value(const TypeId type) {
+	const auto id = static_cast<ValueId>(current_fn->values.size());
+	current_fn->values.push_back({ type });
+	return id;
 }
 
 LabelId IRGen::new_label() {
 	return next_label_id++;
 }
-
-std::vector<BasicBlock> BasicBlockGenerator::function(const LinearFunction& fn) {
-	std::vector<BasicBlock> blocks;
-	bool push_block = true;
-
-	BasicBlock* bb{};
-	for (std::size_t i = 0; i < fn.insts.size(); ++i) {
-		auto& ins = fn.insts[i];
-
-		if (push_block) {
-			bb = &blocks.emplace_back();
-			push_block = false;
-
-			if (ins.opcode == Opcode::Label) {
-				bb->lbl_entry = ins.operands[0];
-			} else {
-				throw std::runtime_error("internal error: BB's should always begin with a label");
-			}
-		}
-
-		bb->inst.push_back(ins);
-
-		if (ins.is_block_terminator()) {
-			push_block = true;
-			continue;
-		}
-
-		if (i + 1 != fn.insts.size()) {
-			const auto& n = fn.insts[i + 1];
-			if (n.opcode == Opcode::Label && n.operands[0] != bb->lbl_entry) {
-				push_block = true;
-
-			}
-		}
-	}
-
-	return blocks;
-}
-
-void BasicBlockGenerator::link_blocks(std::vector<BasicBlock>& blocks, const LinearFunction& fn) {
-	std::unordered_map<LabelId, BasicBlock*> lbl_to_bb;
-
-	using enum Opcode;
-
-	for (auto& bb : blocks) {
-		for (const auto& ins : bb.inst) {
-			if (ins.opcode == Label) {
-				lbl_to_bb[ins.operands[0]] = &bb;
-				continue;
-			}
-		}
-	}
-
-	// Look at the last instruction to connect the blocks
-	for (std::size_t i = 0; i < blocks.size(); ++i) {
-		auto& bb = blocks[i];
-		if (bb.inst.empty()) continue;
-		auto& ins = bb.inst.back();
-
-		if (ins.opcode == Jump) {
-			bb.successors.push_back(lbl_to_bb.at(ins.operands[0]));
-			continue;
-		} else if (ins.opcode == Branch) {
-			bb.successors.push_back(lbl_to_bb.at(ins.operands[1]));
-			bb.successors.push_back(lbl_to_bb.at(ins.operands[2]));
-			continue;
-		} else if (ins.opcode == Return) {
-			bb.successors.push_back(lbl_to_bb.at(fn.epi_lbl));
-			continue;
-		} else {
-			// Insert a fallthrough if we are at the end of the block
-			// and it has no terminator.
-			if (i + 1 < blocks.size()) {
-				bb.inst.push_back(Inst{ Jump, NoValue, {blocks[i + 1].lbl_entry} });
-				bb.successors.push_back(&blocks[i + 1]);
-			}
-		}
-	}
-}
-
-const std::vector<BasicBlock>& BasicBlockGenerator::get_fn_bbs(const std::string& function_name) const {
-	return fn_to_bbs.at(function_name);
-}
\ No newline at end of file
@@ -2,43 +2,25 @@
 #include "ir.hpp"
 #include <optional>
 
-// TODO Make class / standalone function
-struct BasicBlockGenerator {
-	std::vector<BasicBlock> function(const LinearFunction& fn);
-	void link_blocks(std::vector<BasicBlock>& blocks, const LinearFunction& fn);
-	const std::vector<BasicBlock>& get_fn_bbs(const std::string& function_name) const;
-	std::unordered_map<std::string, std::vector<BasicBlock>> fn_to_bbs;
-};
-
-
 class IRGen {
-private:
-	// TODO remove
-	struct Scope {
-		std::unordered_map<std::string, ValueId> symbols;
-	};
-
 public:
-	ValueId gen(const AST::Ptr& ptr);
-	const Value& get_value_by_id(const ValueId value_id) const;
-	const Literal& get_literal_by_id(const ValueId value_id) const;
-	const CFGFunction& get_function_by_name(const std::string& name) const;
+	explicit IRGen(const Interner& interner);
+	void gen(const AST::Root& root);
+	constexpr const Module& get_module() const { return mod; }
+	constexpr Module& get_module() { return mod; }
 	constexpr const auto& get_functions() const { return mod.functions; }
-	bool literal_exists(const ValueId value_id) const;
+	constexpr const TypeContext& get_types() const { return mod.types; }
 
 public:
 	constexpr bool has_errors() const { return !errors.empty(); }
 	constexpr const auto& get_errors() const { return errors; }
 
 private:
-	// dispatchers
-	ValueId top(const AST::Top& top);
-	ValueId stmt(const AST::Stmt& stmt);
-	ValueId expr(const AST::Expr& expr);
+	// dispatcher
+	ValueId gen(const AST::NodeId id);
 
 private:
 	// top
-	ValueId root(const AST::Root& root);
 	ValueId function(const AST::Function& function);
 	ValueId parameter_list(const AST::ParameterList& parameter_list);
 
@@ -56,7 +38,9 @@ private:
 	ValueId while_expr(const AST::WhileExpr& while_expr);
 	ValueId literal_expr(const AST::LiteralExpr& literal);
 	ValueId identifier_expr(const AST::IdentifierExpr& identifier);
-	ValueId binary_expr(const AST::BinaryExpr& binary);
+	ValueId binary_expr(const AST::BinaryExpr& outermost);
+	// one operator of a chain whose left operand is already generated
+	ValueId binary_op(const AST::BinaryExpr& binary, const ValueId left);
 	ValueId assign_expr(const AST::AssignExpr& assign);
 
 private:
@@ -68,30 +52,39 @@ private:
 	
 private:
 	// insts
-	void push_inst(const Opcode o, const ValueId result, const std::vector<ValueId>& operands = {});
+	void push_inst(const Opcode o, const ValueId result, const std::initializer_list<ValueId> operands = {});
+	// ends the current block, falling through into the block of label_id
 	void push_label(const LabelId label_id);
 
+private:
+	// blocks
+	bool is_terminated() const;
+	BlockId block_of(const LabelId label_id) const;
+
 private:
 	// produces a new value and returns its id
-	ValueId new_value(const AST::Type& type);
+	ValueId new_value(const TypeId type);
 	
-private:
-	void enter_scope();
-	std::optional<ValueId> find_symbol(const std::string& name);
-	void exit_scope();
-
 private:
 	LabelId new_label();
 
 private:
+	const Interner& interner;
+	// the function being generated
+	const AST::Tree* tree{};
+	// the binary operators binary_expr is emitting, outermost first
+	std::vector<const AST::BinaryExpr*> spine;
 	std::vector<std::string> errors;
-	std::vector<Value> values;
-	std::unordered_map<ValueId, Literal> literals;
-	std::unordered_map<std::string, LinearFunction> functions;
 
-	std::vector<Scope> scopes;
+	// value of every variable slot of the current function
+	std::vector<ValueId> slot_values;
 	LabelId next_label_id{};
 	Module mod;
-	LinearFunction* current_fn{};
-	BasicBlockGenerator bbg;
+	CFGFunction* current_fn{};
+	// instructions are appended to this block of current_fn
+	BlockId current_block = NoBlock;
+	LabelId epilogue_label{};
+	// block of every label placed in current_fn, indexed from first_label
+	LabelId first_label{};
+	std::vector<BlockId> label_blocks;
 };
\ No newline at end of file
@@ -0,0 +1,146 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <ostream>
+#include <format>
+#include <stdexcept>
+#include <cstdint>
+
+// One bit per analysis of the unit a pass manager runs on
+using AnalysisSet = std::uint32_t;
+constexpr static AnalysisSet NoAnalyses = 0;
+constexpr static AnalysisSet AllAnalyses = ~AnalysisSet{};
+
+// For units without analyses, such as machine code
+struct EmptyAnalyses {
+	void require(const AnalysisSet) {}
+	void invalidate(const AnalysisSet) {}
+};
+
+template <typename Unit, typename Analyses>
+struct Pass {
+	std::string_view name;
+	// computed before the pass runs
+	AnalysisSet required = NoAnalyses;
+	// still valid after the pass changed something
+	AnalysisSet preserved = NoAnalyses;
+	// returns the number of changes made
+	std::function<std::size_t(Unit&, Analyses&)> run;
+};
+
+struct PassStats {
+	std::size_t runs{};
+	std::size_t changes{};
+	std::chrono::steady_clock::duration time{};
+};
+
+// Runs a pipeline of registered passes over a unit, keeping the unit's
+// analyses valid and recording what every pass did.
+// A pipeline is a comma separated list of pass names. A parenthesized
+// group of passes is repeated until none of them changes anything.
+template <typename Unit, typename Analyses>
+class PassManager {
+public:
+	using PassType = Pass<Unit, Analyses>;
+
+	void register_pass(PassType pass) {
+		passes.push_back(std::move(pass));
+		stats.emplace_back();
+	}
+
+	void set_pipeline(const std::string_view text) {
+		pipeline.clear();
+		std::size_t pos = 0;
+		bool in_group = false;
+		while (pos < text.size()) {
+			if (text[pos] == ',') {
+				++pos;
+				continue;
+			}
+			if (text[pos] == '(') {
+				if (in_group) throw std::runtime_error("pass groups cannot be nested");
+				pipeline.push_back({ .repeat = true });
+				in_group = true;
+				++pos;
+				continue;
+			}
+			if (text[pos] == ')') {
+				if (!in_group) throw std::runtime_error("unmatched ) in pass pipeline");
+				in_group = false;
+				++pos;
+				continue;
+			}
+			const auto end = std::min(text.find_first_of(",()", pos), text.size());
+			const auto index = find(text.substr(pos, end - pos));
+			if (!in_group) {
+				pipeline.push_back({});
+			}
+			pipeline.back().passes.push_back(index);
+			pos = end;
+		}
+		if (in_group) throw std::runtime_error("unterminated ( in pass pipeline");
+	}
+
+	// returns the number of changes made
+	std::size_t run(Unit& unit, Analyses& analyses) {
+		std::size_t total = 0;
+		for (const auto& step : pipeline) {
+			std::size_t changes;
+			do {
+				changes = 0;
+				for (const auto index : step.passes) {
+					changes += run_pass(index, unit, analyses);
+				}
+				total += changes;
+			} while (step.repeat && changes);
+		}
+		return total;
+	}
+
+	void print_stats(std::ostream& os) const {
+		os << std::format("{:<20} {:>8} {:>10} {:>12}\n", "pass", "runs", "changes", "time");
+		for (std::size_t i = 0; i < passes.size(); ++i) {
+			if (!stats[i].runs) continue;
+			const double ms = std::chrono::duration<double, std::milli>(stats[i].time).count();
+			os << std::format("{:<20} {:>8} {:>10} {:>9.3f} ms\n", passes[i].name, stats[i].runs, stats[i].changes, ms);
+		}
+	}
+
+private:
+	std::size_t find(const std::string_view name) const {
+		for (std::size_t i = 0; i < passes.size(); ++i) {
+			if (passes[i].name == name) return i;
+		}
+		throw std::runtime_error(std::format("unknown pass '{}'", name));
+	}
+
+	std::size_t run_pass(const std::size_t index, Unit& unit, Analyses& analyses) {
+		const auto& pass = passes[index];
+		auto& stat = stats[index];
+		const auto begin = std::chrono::steady_clock::now();
+		analyses.require(pass.required);
+		const std::size_t changes = pass.run(unit, analyses);
+		if (changes) {
+			analyses.invalidate(pass.preserved);
+		}
+		stat.time += std::chrono::steady_clock::now() - begin;
+		stat.runs += 1;
+		stat.changes += changes;
+		return changes;
+	}
+
+private:
+	struct Step {
+		// indices into passes
+		std::vector<std::size_t> passes;
+		bool repeat{};
+	};
+
+	std::vector<PassType> passes;
+	// parallel to passes
+	std::vector<PassStats> stats;
+	std::vector<Step> pipeline;
+};
@@ -0,0 +1,58 @@
+#include "type-context.hpp"
+#include <functional>
+
+TypeId TypeContext::intern(const AST::Type& type) {
+	if (auto it = ids.find(type); it != ids.end()) {
+		return it->second;
+	}
+	const auto id = static_cast<TypeId>(infos.size());
+	AST::Type stored = type;
+	stored.name = names.spelling(names.intern(type.name));
+	infos.push_back(layout(stored));
+	ids.emplace(stored, id);
+	return id;
+}
+
+TypeInfo TypeContext::layout(const AST::Type& type) {
+	using QualKind = AST::Type::Qualifier::Kind;
+	TypeInfo info{ .type = type };
+
+	if (type.name == "char")        info.size = 1;
+	else if (type.name == "short")  info.size = 2;
+	else if (type.name == "int")    info.size = 4;
+	else if (type.name == "long")   info.size = 8;
+	else if (type.name == "double") info.size = 8, info.reg_class = RegClass::Float;
+	else                            info.size = 1, info.reg_class = RegClass::Memory;
+	info.align = info.size;
+
+	// qualifiers apply inside out, the last one is outermost
+	for (const auto& qual : type.qualifiers()) {
+		if (qual.kind == QualKind::Pointer) {
+			info.size = info.align = 8;
+			info.reg_class = RegClass::Integer;
+		} else {
+			info.size *= qual.array_length;
+			info.reg_class = RegClass::Memory;
+		}
+	}
+	return info;
+}
+
+std::size_t TypeContext::Hash::operator()(const AST::Type& type) const {
+	std::size_t h = std::hash<std::string_view>{}(type.name);
+	for (const auto& qual : type.qualifiers()) {
+		const std::size_t q = (std::size_t(qual.array_length) << 2) | (std::size_t(qual.kind) << 1) | qual.is_const;
+		h = h * 31 + q;
+	}
+	return h;
+}
+
+bool TypeContext::Equal::operator()(const AST::Type& a, const AST::Type& b) const {
+	if (a.name != b.name || a.num_qualifiers != b.num_qualifiers) return false;
+	for (std::size_t i = 0; i < a.num_qualifiers; ++i) {
+		const auto& x = a.qualifier_list[i];
+		const auto& y = b.qualifier_list[i];
+		if (x.is_const != y.is_const || x.kind != y.kind || x.array_length != y.array_length) return false;
+	}
+	return true;
+}
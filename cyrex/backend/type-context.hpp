@@ -0,0 +1,50 @@
+#pragma once
+#include "frontend/ast.hpp"
+#include "frontend/interner.hpp"
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+// Dense id of an interned type
+using TypeId = std::uint32_t;
+
+// How a value of a type is passed around by the backend
+enum class RegClass : std::uint8_t {
+	Integer,
+	Float,
+	// aggregates and unknown types live in memory
+	Memory,
+};
+
+struct TypeInfo {
+	AST::Type type;
+	std::uint32_t size{};
+	std::uint32_t align{};
+	RegClass reg_class{};
+};
+
+// Hash-conses types so that equal types share one TypeId, and computes
+// their layout once instead of on every use.
+class TypeContext {
+public:
+	TypeId intern(const AST::Type& type);
+	const TypeInfo& info(const TypeId id) const { return infos[id]; }
+	const AST::Type& type(const TypeId id) const { return infos[id].type; }
+	std::size_t size() const { return infos.size(); }
+
+private:
+	static TypeInfo layout(const AST::Type& type);
+
+	struct Hash {
+		std::size_t operator()(const AST::Type& type) const;
+	};
+	struct Equal {
+		bool operator()(const AST::Type& a, const AST::Type& b) const;
+	};
+
+private:
+	// owns the spelling of type names, types may outlive the source
+	Interner names;
+	std::unordered_map<AST::Type, TypeId, Hash, Equal> ids;
+	std::vector<TypeInfo> infos;
+};
@@ -2,33 +2,34 @@
 #include <format>
 
 void X64::consume(const ValueId value_id) {
-	if (!locations.contains(value_id)) return;
-	auto& l = locations.at(value_id);
+	if (!is_allocated(value_id)) return;
+	auto& l = locations[value_id];
 	if (l.lifetime == ValueLifetime::Persistent) return;
 	if (l.kind == ValueLocation::Kind::Reg) {
-		printf("consumed v%d\n", value_id);
-		claimed_regs.erase(l.loc.reg);
-		locations.erase(value_id);
+		claimed_regs &= ~(1u << static_cast<int>(l.loc.reg));
+		l = {};
 	}
 }
 
-X64::TypeSize X64::type_size(const AST::Type& type) {
-	if (!type.qualifiers.empty()) {
-		for (const auto& qual : type.qualifiers)
-			if (qual.kind == AST::Type::Qualifier::Kind::Pointer)
-				return { .elem_size = RegSize::Qword, .num_bytes = 8, .is_array = false };
+X64::TypeSize X64::type_size(const TypeId type) {
+	const auto& info = mod.types.info(type);
+	const bool in_memory = info.reg_class == RegClass::Memory;
+	RegSize elem_size = RegSize::Byte;
+	if (!in_memory) {
+		switch (info.size) {
+			case 2: elem_size = RegSize::Word; break;
+			case 4: elem_size = RegSize::Dword; break;
+			case 8: elem_size = RegSize::Qword; break;
+		}
 	}
-
-	if (type.name == "char")  return { .elem_size = RegSize::Byte, .num_bytes = 1, .is_array = false };
-	if (type.name == "short") return { .elem_size = RegSize::Word, .num_bytes = 2, .is_array = false };
-	if (type.name == "int")   return { .elem_size = RegSize::Dword, .num_bytes = 4, .is_array = false };
-	if (type.name == "long")  return { .elem_size = RegSize::Qword, .num_bytes = 8, .is_array = false };
-	return { .elem_size = RegSize::Byte, .num_bytes = 1, .is_array = false };
+	return { .elem_size = elem_size, .num_bytes = static_cast<int>(info.size), .is_array = in_memory };
 }
 
 void X64::alloc_stack(const ValueId value_id, const ValueLifetime lifetime) {
-	const auto& value = ir.get_value_by_id(value_id);
-	function_mc.stack_size += type_size(value.type).num_bytes;
+	const auto& value = current_fn->values[value_id];
+	// values are computed in qword registers, so a spilled one takes a qword
+	const auto size = type_size(value.type);
+	function_mc.stack_size += size.is_array ? size.num_bytes : 8;
 	locations[value_id] = {
 		.kind = ValueLocation::Kind::Stack,
 		.loc = function_mc.stack_size,
@@ -36,10 +37,10 @@ void X64::alloc_stack(const ValueId value_id, const ValueLifetime lifetime) {
 }
 
 void X64::alloc_reg(const ValueId value_id, const Reg reg, const ValueLifetime lifetime) {
-	if (claimed_regs.contains(reg)) {
+	if (is_claimed(reg)) {
 		throw std::runtime_error(std::format("internal error: {} is already claimed", reg_to_string(reg)));
 	}
-	claimed_regs[reg] = value_id;
+	claimed_regs |= 1u << static_cast<int>(reg);
 	locations[value_id] = {
 		.kind = ValueLocation::Kind::Reg,
 		.loc = (int)reg,
@@ -48,10 +49,10 @@ void X64::alloc_reg(const ValueId value_id, const Reg reg, const ValueLifetime l
 }
 
 bool X64::is_temporary(const ValueId value_id) {
-	if (!locations.contains(value_id)) {
+	if (!is_allocated(value_id)) {
 		return false;
 	}
-	return locations.at(value_id).lifetime == ValueLifetime::Temporary;
+	return locations[value_id].lifetime == ValueLifetime::Temporary;
 }
 
 void X64::save_callee_reg(const Reg reg) {
@@ -65,12 +66,12 @@ void X64::save_callee_reg(const Reg reg) {
 
 void X64::alloc_on_demand(const ValueId value_id) {
 	// Is it already allocated?
-	if (locations.contains(value_id)) return;
+	if (is_allocated(value_id)) return;
 
 	// First, try the volatile regs
 	for (auto r : volatile_regs) {
 		if (r == Reg::rax) continue;
-		if (!claimed_regs.contains(r)) {
+		if (!is_claimed(r)) {
 			alloc_reg(value_id, r, ValueLifetime::Temporary);
 			return;
 		}
@@ -78,7 +79,7 @@ void X64::alloc_on_demand(const ValueId value_id) {
 
 	// Then the callee saved
 	for (auto r : callee_saved_regs) {
-		if (!claimed_regs.contains(r)) {
+		if (!is_claimed(r)) {
 			alloc_reg(value_id, r, ValueLifetime::Temporary);
 			save_callee_reg(r);
 			return;
@@ -87,4 +88,13 @@ void X64::alloc_on_demand(const ValueId value_id) {
 
 	// Spill
 	alloc_stack(value_id, ValueLifetime::Temporary);
-}
\ No newline at end of file
+}
+
+bool X64::is_allocated(const ValueId value_id) const {
+	return value_id != NoValue && locations[value_id].kind != ValueLocation::Kind::None;
+}
+
+bool X64::is_claimed(const Reg reg) const {
+	// only qword registers are allocated
+	return claimed_regs & (1u << static_cast<int>(reg));
+}
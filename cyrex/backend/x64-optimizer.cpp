@@ -52,15 +52,32 @@ constexpr static bool compile_time_binary_compare(auto l, auto r, CompileTimeCom
 }
 
 
-bool X64Optimizer::pass(std::vector<MC>& mc) {
-	if (!is_enabled) return false;
-	return (pass_peephole(mc) || pass_unused_labels(mc));
+X64Optimizer::X64Optimizer() {
+	using Analyses = EmptyAnalyses;
+	passes.register_pass({ .name = "peephole", .run = [this](std::vector<MC>& mc, Analyses&) { return pass_peephole(mc); } });
+	passes.register_pass({ .name = "unused-labels", .run = [this](std::vector<MC>& mc, Analyses&) { return pass_unused_labels(mc); } });
+	passes.register_pass({ .name = "push-pop", .run = [this](std::vector<MC>& mc, Analyses&) { return remove_redundant_push_pop(mc); } });
 }
 
-bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
+std::size_t X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 	using enum MC::Opcode;
 	using enum Reg;
-	bool changed = false;
+	std::size_t changes = 0;
+
+	// a register written right before the one read of its value is dead after
+	// that read. Otherwise only rax, the scratch register, is.
+	std::vector<std::uint32_t> reads(fn ? fn->values.size() : 0);
+	if (fn) {
+		for (const auto& bb : fn->blocks) {
+			for (const auto& ins : bb.inst) {
+				for (const auto value : ins.used_values(fn->extra_operands)) ++reads[value];
+			}
+		}
+	}
+	const auto is_dead_after = [&](const Operand& written, const Operand& read) {
+		if (written.is_rax()) return true;
+		return written.value_id != NoValue && written.value_id == read.value_id && reads[written.value_id] == 1;
+	};
 
 	for (auto it = mc.begin(); it != mc.end(); ) {
 		const auto remaining = [&](size_t n) {
@@ -74,7 +91,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 		if (a.op == MC::Opcode::Mov) {
 			if (a.src && *a.src == *a.dst) {
 				it = mc.erase(it);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -113,7 +130,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				*it = fold;
 				mc.erase(it + 1, it + 6);
 
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -138,7 +155,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				auto dst = c.dst;
 				it = mc.erase(it, it + 3);
 				it = mc.insert(it, MC::jmp(*dst));
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -163,7 +180,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				auto lbl_is_zero = *d.dst;
 				it = mc.erase(it, it + 3);
 				it = mc.insert(it, MC::jmp(lbl_is_zero));
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -185,7 +202,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				const MC fold = MC::mov(*b.dst, *a.src);
 				*it = fold;
 				mc.erase(nit);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -204,6 +221,9 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				b.is_binary_math_operation() &&
 				c.op == Mov &&
 				a.dst && b.dst && c.src && c.dst &&
+				a.dst->is_rax() &&
+				!b.src->is_rax() &&
+				!(c.dst->is_mem() && !b.src->is_reg()) &&
 				*a.dst == *b.dst &&
 				*a.dst == *c.src &&
 				*a.src == *c.dst) {
@@ -214,26 +234,28 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				folded.src = b.src;
 				*it = folded;
 				mc.erase(it + 1, it + 3);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
 
 		// Const elimination
-		// mov rcx, rbx OR imm
-		// add rdx, rcx
+		// mov rax, rbx OR imm
+		// add rdx, rax
 		// -> add rdx, rbx OR imm
 		if (remaining(1)) {
 			auto& b = it[1];
 			if (
 				a.op == Mov && b.is_binary_math_operation() &&
-				a.dst->is_reg() &&
-				*a.dst == *b.src
+				a.dst->is_rax() && !b.dst->is_rax() &&
+				*a.dst == *b.src &&
+				!(b.dst->is_mem() && !a.src->is_reg())
 				) {
-				const MC folded = MC::add(*b.dst, *a.src);
+				MC folded = b;
+				folded.src = a.src;
 				*it = folded;
 				mc.erase(it + 1);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -246,12 +268,12 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 		if (remaining(1)) {
 			auto& b = it[1];
 			if (a.op == Xor &&
-				a.dst == a.src &&
-				b.op == Mov && *b.src == *a.dst) {
+				a.dst == a.src && a.dst->is_rax() &&
+				b.op == Mov && *b.src == *a.dst && !b.dst->is_mem()) {
 				MC fold = MC::l_xor(*b.dst, *b.dst);
 				*it = fold;
 				mc.erase(it + 1);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -266,13 +288,13 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 
 			if (a.op == Xor &&
 				*a.src == *a.dst &&
-				ir.literal_exists(a.src->value_id) &&
+				a.src->value_id != NoValue && fn->is_literal(a.src->value_id) &&
 				b.op == Cmp &&
 				b.lhs->is_reg() && b.rhs == a.src) {
 				MC fold = MC::cmp(*b.lhs, Operand::make_imm(0));
 				*it = fold;
 				mc.erase(it + 1);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -295,7 +317,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				MC fold = MC::jmp(*c.dst);
 				mc.erase(it + 2);
 				it[1] = fold;
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -314,7 +336,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				b.src->is_reg()
 				) {
 				it = mc.erase(it);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -328,7 +350,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 			auto b = it[1];
 			if (a.op == Jmp && b.is_conditional_jump()) {
 				mc.erase(it + 1);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -341,7 +363,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 			auto b = it[1];
 			if (a.op == Jmp && b.op == Label && a.dst->is_imm() && a.dst->imm == b.lbl) {
 				it = mc.erase(it);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -357,7 +379,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 			) {
 			MC fold = MC::l_xor(*a.dst, *a.dst);
 			*it = fold;
-			changed = true;
+			++changes;
 			continue;
 		}
 
@@ -383,11 +405,13 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 		if (remaining(1)) {
 			auto b = it[1];
 			if (a.op == Mov && b.op == Mov &&
-				*a.dst == *b.src) {
+				*a.dst == *b.src &&
+				is_dead_after(*a.dst, *b.src) &&
+				!(a.src->is_mem() && b.dst->is_mem())) {
 				const MC folded = MC::mov(*b.dst, *a.src);
 				*it = folded;
 				mc.erase(it + 1);
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -421,7 +445,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				it[2] = folds[2];
 				mc.erase(it + 3, it + 6);
 
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -456,7 +480,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				it[1] = folds[1];
 				mc.erase(it + 2, it + 5);
 
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -494,7 +518,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				it = mc.erase(it, it + 2);
 				it = mc.insert(it, MC::jmp(true_dst));
 
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -519,7 +543,7 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 				*it = folded;
 				mc.erase(it + 1);
 
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -529,16 +553,19 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 		// cmp rax, rdx
 		// ->
 		// cmp rcx, rdx
+		// cmp takes no immediate on the left and one memory operand at most,
+		// which needs a register on the right to give its size
 
 		if (remaining(2)) {
 			auto b = it[1];
 			if (a.op == Mov && a.dst->is_rax() &&
-				b.op == Cmp && b.lhs->is_rax()
+				b.op == Cmp && b.lhs->is_rax() &&
+				!a.src->is_imm() && !(a.src->is_mem() && !b.rhs->is_reg())
 				) {
 				auto old_src = a.src;
 				it = mc.erase(it);
 				it->lhs = old_src;
-				changed = true;
+				++changes;
 				continue;
 			}
 		}
@@ -566,21 +593,44 @@ bool X64Optimizer::pass_peephole(std::vector<MC>& mc) {
 
 				it = std::next(it);
 				it = mc.erase(it);
-				changed = true;
+				++changes;
 				continue;
 			}
 
 		}
 
+		// Redundant jXX removal
+		// J_if_true Ltrue
+		// J_if_false Lfalse
+		// Lfalse:...
+		// ->
+		// J_if_true Ltrue
+		// Lfalse:
+		if (remaining(3)) {
+			auto b = it[1];
+			auto c = it[2];
+
+			if (
+				a.is_conditional_jump() &&
+				b.op == a.negated_jump().op &&
+				c.op == Label &&
+				*c.lbl == b.dst->imm) {
+
+				mc.erase(it + 1);
+				++changes;
+				continue;
+			}
+		}
+
 
 		it = std::next(it);
 	}
 
-	return changed;
+	return changes;
 }
 
-bool X64Optimizer::pass_unused_labels(std::vector<MC>& mc) {
-	bool changed = false;
+std::size_t X64Optimizer::pass_unused_labels(std::vector<MC>& mc) {
+	std::size_t changes = 0;
 	std::unordered_set<int> referenced_labels;
 
 	for (auto& ins : mc) {
@@ -597,17 +647,17 @@ bool X64Optimizer::pass_unused_labels(std::vector<MC>& mc) {
 		auto& ins = *it;
 		if (ins.op == MC::Opcode::Label && !referenced_labels.contains(*ins.lbl)) {
 			it = mc.erase(it);
-			changed = true;
+			++changes;
 			continue;
 		}
 
 		it = std::next(it);
 	}
 
-	return changed;
+	return changes;
 }
 
-void X64Optimizer::remove_redundant_push_pop(std::vector<MC>& mc) {
+std::size_t X64Optimizer::remove_redundant_push_pop(std::vector<MC>& mc) {
 	std::unordered_set<Reg> to_remove;
 	using enum MC::Opcode;
 
@@ -639,7 +689,7 @@ void X64Optimizer::remove_redundant_push_pop(std::vector<MC>& mc) {
 		X(ins.dst);
 	}
 
-	std::erase_if(mc, [&](auto& ins) {
+	return std::erase_if(mc, [&](auto& ins) {
 		if (ins.op == Push && to_remove.contains(ins.src->reg)) {
 			return true;
 		}
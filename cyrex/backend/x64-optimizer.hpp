@@ -1,14 +1,21 @@
 #pragma once
 #include "x64.hpp"
+#include "pass-manager.hpp"
+
+using MachinePassManager = PassManager<std::vector<X64::MC>, EmptyAnalyses>;
 
 struct X64Optimizer {
 	using MC = X64::MC;
 	using Operand = X64::Operand;
 	using Reg = X64::Reg;
-	IRGen& ir;
-	bool is_enabled{};
-	bool pass(std::vector<MC>& mc);
-	bool pass_peephole(std::vector<MC>& mc);
-	bool pass_unused_labels(std::vector<MC>& mc);
-	void remove_redundant_push_pop(std::vector<MC>& mc);
+	// registers the passes below as peephole, unused-labels and push-pop
+	X64Optimizer();
+	// the registered passes refer to this optimizer
+	X64Optimizer(const X64Optimizer&) = delete;
+	// the function being optimized, set by X64
+	const CFGFunction* fn{};
+	MachinePassManager passes;
+	std::size_t pass_peephole(std::vector<MC>& mc);
+	std::size_t pass_unused_labels(std::vector<MC>& mc);
+	std::size_t remove_redundant_push_pop(std::vector<MC>& mc);
 };
\ No newline at end of file
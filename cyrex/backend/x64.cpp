@@ -1,65 +1,55 @@
 #include"x64.hpp"
 #include "x64-optimizer.hpp"
+#include "analysis.hpp"
 
 #include <format>
 
-// To be removed:
-struct AllocationStrategy {
-	std::optional<X64::ValueLifetime> lifetime = std::nullopt;
-	std::vector<bool> consumption{};
-
-	AllocationStrategy(const std::string& strategy) {
-		switch (strategy[0]) {
-			case 'p': lifetime = X64::ValueLifetime::Persistent; break;
-			case 't': lifetime = X64::ValueLifetime::Temporary; break;
-			case 's': lifetime = X64::ValueLifetime::Scratch; break;
-			case 'x': break;
-			default:
-			throw std::runtime_error("undefined destination strategy");
-		}
+// where the value every instruction writes is kept, nullopt for instructions writing none.
+// A store writes its variable, which may have been given back after a store before it.
+static std::optional<X64::ValueLifetime> written_lifetime(const Opcode opcode) {
+	using enum Opcode;
+	switch (opcode) {
+		case Alloc: return X64::ValueLifetime::Persistent;
+		case Const: return X64::ValueLifetime::Scratch;
+		case Label:
+		case Branch:
+		case Jump:
+		case Return: return std::nullopt;
+		default: return X64::ValueLifetime::Temporary;
+	}
+}
 
-		for (int i = 1; i < strategy.size(); ++i) {
-			if (strategy[i] == 'y') {
-				consumption.push_back(true);
-			} else if (strategy[i] == 'n') {
-				consumption.push_back(false);
-			} else {
-				throw std::runtime_error("undefined consumption strategy");
+// The last block in layout order that a value is live in or mentioned by.
+// Blocks are generated in layout order, so the register of a value can only
+// be given back in that block, an earlier one would hand it out again while
+// a later block, such as a loop header the value is live around, still needs it.
+static std::vector<BlockId> last_live_blocks(const CFGFunction& fn, const Liveness& liveness) {
+	std::vector<BlockId> last(fn.values.size(), NoBlock);
+	for (BlockId block = 0; block < fn.blocks.size(); ++block) {
+		for (const auto& ins : fn.blocks[block].inst) {
+			for (const auto value : ins.used_values(fn.extra_operands)) {
+				last[value] = block;
+			}
+			if (const auto value = ins.written_value(); value != NoValue) {
+				last[value] = block;
 			}
 		}
+		// live in values are read in the block or live out of it
+		liveness.live_out[block].for_each([&](const std::size_t i) {
+			last[liveness.values[i]] = block;
+		});
 	}
-};
-
-const static std::unordered_map<Opcode, AllocationStrategy> alloc_strategy = {
-	{Opcode::Alloc,				{"p"}},
-	{Opcode::Const,				{"sn"}},
-	{Opcode::Store,				{"xnn"}},
-	{Opcode::Load,				{"tn"}},
-	{Opcode::Add,				{"tnn"}},
-	{Opcode::Sub,				{"tnn"}},
-	{Opcode::Lesser,			{"tnn"}},
-	{Opcode::LesserOrEqual,		{"tnn"}},
-	{Opcode::Greater,			{"tnn"}},
-	{Opcode::GreaterOrEqual,	{"tnn"}},
-	{Opcode::Equal,				{"tnn"}},
-	{Opcode::NotEqual,			{"tnn"}},
-	{Opcode::And,				{"tnn"}},
-	{Opcode::Or,				{"tnn"}},
-	{Opcode::Xor,				{"tnn"}},
-	{Opcode::Label,				{"xn"}},
-	{Opcode::Branch,			{"xnnn"}},
-	{Opcode::Jump,				{"xn"}},
-	{Opcode::Return,			{"xn"}},
-};
-
-X64::X64(IRGen& ir, X64Optimizer& optimizer) : ir(ir), optimizer(optimizer) {}
+	return last;
+}
+
+X64::X64(const Module& mod, X64Optimizer& optimizer) : mod(mod), optimizer(optimizer) {}
 
 
 void X64::module() {
 	function_textstream << "bits 64\n";
 	function_textstream << "section .text\n";
 
-	for (const auto& [fn_name, fn] : ir.get_functions()) {
+	for (const auto& [fn_name, fn] : mod.functions) {
 		function_textstream << "global " << fn_name << '\n';
 		function(fn_name, fn);
 	}
@@ -72,11 +62,29 @@ void X64::function(const std::string& name, const CFGFunction& fn) {
 
 	function_mc = {};
 	function_mc.epi_lbl = fn.blocks.back().lbl_entry;
+	current_fn = &fn;
+	optimizer.fn = &fn;
+	locations.assign(fn.values.size(), {});
+	claimed_regs = 0;
+
+	FunctionAnalyses analyses{ fn };
+	const auto& liveness = analyses.liveness();
+	const auto last_block = last_live_blocks(fn, liveness);
+	LastUses last_uses{ fn, liveness };
 
 	// generate machine code
-	for (const auto& bb : fn.blocks) {
-		for (const auto& inst : bb.inst) {
-			instruction(function_mc.block, inst);
+	for (BlockId block = 0; block < fn.blocks.size(); ++block) {
+		const auto& insts = fn.blocks[block].inst;
+		const auto deaths = last_uses.block(block);
+		auto death = deaths.begin();
+		for (std::uint32_t i = 0; i < insts.size(); ++i) {
+			instruction(function_mc.block, insts[i]);
+			// a value live out of its last block goes back to an earlier one, which reads its location
+			for (; death != deaths.end() && death->inst == i; ++death) {
+				if (last_block[death->value] == block && !liveness.is_live_out(block, death->value)) {
+					consume(death->value);
+				}
+			}
 		}
 	}
 
@@ -129,10 +137,9 @@ void X64::function(const std::string& name, const CFGFunction& fn) {
 }
 
 void X64::instruction(std::vector<MC>& mc, const Inst& inst) {
-	const auto& strat = alloc_strategy.at(inst.opcode);
-
-	if (strat.lifetime && *strat.lifetime != ValueLifetime::Scratch) {
-		alloc_on_demand(inst.result);
+	const auto lifetime = written_lifetime(inst.opcode);
+	if (lifetime && *lifetime != ValueLifetime::Scratch) {
+		alloc_on_demand(inst.written_value());
 	}
 
 	const auto push_mc = [&](auto ins) {
@@ -142,7 +149,7 @@ void X64::instruction(std::vector<MC>& mc, const Inst& inst) {
 	using enum Reg;
 	using enum Opcode;
 	const auto result = [&]() { return operand(inst.result); };
-	const auto inst_operand = [&](int index) { return operand(inst.operands[index]); };
+	const auto inst_operand = [&](int index) { return operand(inst.operand(index)); };
 	const auto src = [&]() { return inst_operand(0); };
 	const auto lhs = [&]() { return inst_operand(0); };
 	const auto rhs = [&]() { return inst_operand(1); };
@@ -186,38 +193,44 @@ void X64::instruction(std::vector<MC>& mc, const Inst& inst) {
 		case GreaterOrEqual: cmp(MC::setge); break;
 		case Equal: cmp(MC::sete); break;
 		case NotEqual: cmp(MC::setne); break;
-		case And: break;
-		case Or: break;
-		case Xor: break;
-		case Label: push_mc(MC::label(inst.operands[0])); break;
+		case And:
+		push_mc(MC::mov(reg(rax), lhs()));
+		push_mc(MC::l_and(reg(rax), rhs()));
+		push_mc(MC::mov(result(), reg(rax)));
+		break;
+		case Or:
+		push_mc(MC::mov(reg(rax), lhs()));
+		push_mc(MC::l_or(reg(rax), rhs()));
+		push_mc(MC::mov(result(), reg(rax)));
+		break;
+		case Xor:
+		push_mc(MC::mov(reg(rax), lhs()));
+		push_mc(MC::l_xor(reg(rax), rhs()));
+		push_mc(MC::mov(result(), reg(rax)));
+		break;
+		case Label: push_mc(MC::label(inst.operand(0))); break;
 		case Branch:
 		push_mc(MC::mov(reg(rax), src()));
 		push_mc(MC::test(reg(rax), reg(rax)));
-		push_mc(MC::jnz(Operand::make_imm(inst.operands[1])));
-		push_mc(MC::jz(Operand::make_imm(inst.operands[2])));
+		push_mc(MC::jnz(Operand::make_imm(inst.operand(1))));
+		push_mc(MC::jz(Operand::make_imm(inst.operand(2))));
 		break;
 		case Jump:
-		push_mc(MC::jmp(Operand::make_imm(inst.operands[0])));
+		push_mc(MC::jmp(Operand::make_imm(inst.operand(0))));
 		break;
 		case Return:
-		if (inst.operands[0] != NoValue) {
-			push_mc(MC::mov(reg(rax), operand(inst.operands[0])));
+		if (inst.operand(0) != NoValue) {
+			push_mc(MC::mov(reg(rax), operand(inst.operand(0))));
 		}
 		push_mc(MC::jmp(Operand::make_imm(function_mc.epi_lbl)));
 		break;
-	}
-
-	// consumption
-	for (int i = 0; i < inst.operands.size(); ++i) {
-		if (strat.consumption[i]) {
-			consume(inst.operands[i]);
-		}
+		case Phi: throw std::runtime_error("internal error: phi in code generation, lower_phis must run first");
 	}
 }
 
 void X64::optimize(std::vector<MC>& mc) {
-	while (optimizer.pass(mc)) {}
-	optimizer.remove_redundant_push_pop(mc);
+	EmptyAnalyses analyses;
+	optimizer.passes.run(mc, analyses);
 }
 
 std::string X64::assembly() const {
@@ -225,11 +238,11 @@ std::string X64::assembly() const {
 }
 
 X64::Operand X64::operand(const ValueId value_id) {
-	if (locations.contains(value_id)) {
+	if (is_allocated(value_id)) {
 		return location(value_id);
 	}
 
-	if (ir.literal_exists(value_id)) {
+	if (current_fn->is_literal(value_id)) {
 		return constant(value_id);
 	}
 	throw std::runtime_error("internal error: use of unallocated value");
@@ -239,12 +252,12 @@ X64::Operand X64::constant(const ValueId constant_value_id) {
 	// It must be a constant
 	return std::visit([&](auto&& v) {
 		return Operand::make_imm((int64_t)v, constant_value_id);
-	}, ir.get_literal_by_id(constant_value_id).data);
+	}, current_fn->literal(constant_value_id).data);
 }
 
 
 X64::Operand X64::location(const ValueId value_id) {
-	const auto& loc = locations.at(value_id);
+	const auto& loc = locations[value_id];
 	if (loc.kind == ValueLocation::Kind::Reg) {
 		return Operand::make_reg((Reg)loc.loc.reg, value_id);
 	} else {
@@ -273,7 +286,8 @@ void X64::emit(std::ostream& ts, const std::vector<MC>& mc) {
 			// Mov
 			case Mov:
 			if (ins.dst->value_id != NoValue && ins.dst->is_mem()) {
-				ts << format("\tmov {} {}, {}\n", type_size(ir.get_value_by_id(ins.dst->value_id).type).str(), emit(*ins.dst), emit(*ins.src)); break;
+				const auto size = type_size(current_fn->values[ins.dst->value_id].type);
+				ts << format("\tmov {} {}, {}\n", size.is_array ? size.str() : "qword", emit(*ins.dst), emit(*ins.src)); break;
 			} else {
 				ts << format("\tmov {}, {}\n", emit(*ins.dst), emit(*ins.src)); break;
 			}
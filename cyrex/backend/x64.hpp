@@ -107,7 +107,7 @@ public:
 
 	struct ValueLocation {
 		enum class Kind {
-			Stack, Reg
+			None, Stack, Reg
 		};
 		Kind kind{};
 		union { int stack; Reg reg; } loc{};
@@ -430,7 +430,7 @@ public:
 	};
 
 public:
-	explicit X64(IRGen& ir, X64Optimizer& optimizer);
+	explicit X64(const Module& mod, X64Optimizer& optimizer);
 	void module();
 	void optimize(std::vector<MC>& mc);
 	std::string assembly() const;
@@ -442,11 +442,13 @@ private:
 	// Allocation
 	// implemented in x64-allocator.cpp
 	void consume(const ValueId value_id);
-	TypeSize type_size(const AST::Type& type);
+	TypeSize type_size(const TypeId type);
 	void alloc_stack(const ValueId value_id, const ValueLifetime lifetime);
 	void alloc_reg(const ValueId value_id, const Reg reg, const ValueLifetime lifetime);
 	bool is_temporary(const ValueId value_id);
 	void save_callee_reg(const Reg reg);
+	bool is_allocated(const ValueId value_id) const;
+	bool is_claimed(const Reg reg) const;
 
 	// Location
 	void alloc_on_demand(const ValueId value_id);
@@ -458,11 +460,15 @@ private:
 	std::string emit(const Operand& operand);
 	void emit(std::ostream& ts, const std::vector<MC>& mc);
 
-	IRGen& ir;
+	const Module& mod;
 	X64Optimizer& optimizer;
+	const CFGFunction* current_fn{};
 
-	std::unordered_map<ValueId, ValueLocation> locations;
-	std::unordered_map<Reg, ValueId> claimed_regs;
+	// indexed by the values of the current function
+	std::vector<ValueLocation> locations;
+	// one bit per qword register
+	std::uint16_t claimed_regs{};
+	static_assert(static_cast<int>(Reg::r15) < 16);
 
 	// Machine code
 	FunctionMC function_mc;
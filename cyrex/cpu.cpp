@@ -0,0 +1,23 @@
+#include "cpu.hpp"
+
+#if defined(CYREX_X64) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+bool cpu_has_avx2() {
+#if !defined(CYREX_X64)
+	return false;
+#elif defined(__GNUC__) || defined(__clang__)
+	return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+	int info[4]{};
+	__cpuid(info, 0);
+	if (info[0] < 7) return false;
+	__cpuid(info, 1);
+	const bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+	__cpuidex(info, 7, 0);
+	return os_saves_ymm && (info[1] & (1 << 5));
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Instruction sets of the kernels that work a block at a time, such as the
+// lexer's scanners and the dataflow bit sets
+enum class Isa {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+constexpr const char* isa_name(const Isa isa) {
+	switch (isa) {
+		case Isa::Scalar: return "scalar";
+		case Isa::SSE2: return "sse2";
+		case Isa::AVX2: return "avx2";
+	}
+	return "?";
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+// sse2 is part of x86-64, avx2 is picked at runtime
+#define CYREX_X64
+#endif
+
+// avx2 kernels are compiled for avx2 on their own and only called once
+// cpu_has_avx2 says the cpu has it
+#if defined(__GNUC__) || defined(__clang__)
+#define CYREX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CYREX_TARGET_AVX2
+#endif
+
+bool cpu_has_avx2();
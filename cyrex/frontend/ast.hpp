@@ -1,17 +1,63 @@
 #pragma once
-#include <string>
-#include <memory>
-#include <variant>
+#include "interner.hpp"
+#include "diagnostics.hpp"
+#include <string_view>
+#include <array>
+#include <span>
+#include <tuple>
 #include <vector>
-#include <optional>
+#include <utility>
+#include <cstdint>
+#include <stdexcept>
 
+// The AST is stored flat: every function is a Tree whose nodes are a kind
+// tag and an index into the payload table of that kind. Nodes refer to
+// their children by NodeId, and child lists are ranges of a shared array.
 struct AST {
-	using Name = std::string;
-	using Ptr = std::unique_ptr<AST>;
+	using Name = SymbolId;
+	using NodeId = std::uint32_t;
+
+	// node 0 of every tree, so a missing child tests false
+	constexpr static NodeId NoNode = 0;
+
+	// a range of the tree's list items
+	struct List {
+		std::uint32_t first{};
+		std::uint32_t size{};
+	};
+
+	enum class Kind : std::uint8_t {
+		None,
+		// top level
+		Function,
+		ParameterList,
+		// expressions
+		BinaryExpr,
+		IdentifierExpr,
+		LiteralExpr,
+		AssignExpr,
+		WhileExpr,
+		IfExpr,
+		TupleExpr,
+		TupleAssignExpr,
+		// statements
+		BlockStmt,
+		ReturnStmt,
+		VariableStmt,
+		WhileStmt,
+		IfStmt,
+	};
+
+	// index of a variable among the variables of its function
+	using Slot = std::uint32_t;
+	constexpr static Slot NoSlot = ~Slot{};
 
 	struct Symbol {
 		Name name;
 		bool is_assignable{};
+		// set by semantic analysis, for declarations and their uses alike
+		Slot slot = NoSlot;
+		SourceLoc loc{};
 	};
 
 	struct Type {
@@ -25,30 +71,45 @@ struct AST {
 			int array_length{};
 		};
 
-		Name name;
-		std::vector<Qualifier> qualifiers;
+		// deeper types are rejected by the parser
+		constexpr static std::size_t max_qualifiers = 4;
+
+		std::string_view name;
+		std::array<Qualifier, max_qualifiers> qualifier_list{};
+		std::uint8_t num_qualifiers{};
+
+		constexpr std::span<const Qualifier> qualifiers() const {
+			return { qualifier_list.data(), num_qualifiers };
+		}
+
+		constexpr bool add_qualifier(const Qualifier& qualifier) {
+			if (num_qualifiers == max_qualifiers) return false;
+			qualifier_list[num_qualifiers++] = qualifier;
+			return true;
+		}
 	};
 
 
 	// -- top level --
 	struct Function {
+		constexpr static AST::Kind node_kind = AST::Kind::Function;
 		Name name{};
 		Type return_type{};
 		// paramater list
-		Ptr parameter_list{};
-		Ptr block{};
+		NodeId parameter_list{};
+		NodeId block{};
+		// variables declared in the function, set by semantic analysis
+		std::uint32_t num_slots{};
 	};
 
 	struct ParameterList {
-		std::vector<Ptr> items;
-	};
-
-	struct Root {
-		std::vector<Ptr> functions;
+		constexpr static AST::Kind node_kind = AST::Kind::ParameterList;
+		List items;
 	};
 
 	// -- expressions --
 	struct BinaryExpr {
+		constexpr static AST::Kind node_kind = AST::Kind::BinaryExpr;
 		enum class Kind {
 			CmpLesser,
 			CmpLesserOrEqual,
@@ -63,91 +124,190 @@ struct AST {
 			Sub,
 		};
 
-		Ptr left{}, right{};
+		NodeId left{}, right{};
 		Kind kind;
 	};
 
 	struct IdentifierExpr {
-		Name name;
+		constexpr static AST::Kind node_kind = AST::Kind::IdentifierExpr;
+		Symbol sym;
 	};
 
 	struct LiteralExpr {
+		constexpr static AST::Kind node_kind = AST::Kind::LiteralExpr;
 		Type type;
-		std::string value;
+		// points into the source text, empty for folded constants
+		std::string_view value;
+		// value of integer literals
+		std::int64_t number{};
 	};
 
 	struct WhileExpr {
-		Ptr condition;
-		Ptr block;
-		Ptr returns;
+		constexpr static AST::Kind node_kind = AST::Kind::WhileExpr;
+		NodeId condition;
+		NodeId block;
+		NodeId returns;
 	};
 
 	struct IfExpr {
-		Ptr condition;
-		Ptr then_expr;
-		Ptr else_expr;
+		constexpr static AST::Kind node_kind = AST::Kind::IfExpr;
+		NodeId condition;
+		NodeId then_expr;
+		NodeId else_expr;
 	};
 
 	struct AssignExpr {
-		Ptr left;
-		Ptr expr;
+		constexpr static AST::Kind node_kind = AST::Kind::AssignExpr;
+		NodeId left;
+		NodeId expr;
+		// of the =
+		SourceLoc loc{};
 	};
 
 	struct TupleExpr {
-		std::vector<Ptr> exprs;
+		constexpr static AST::Kind node_kind = AST::Kind::TupleExpr;
+		List exprs;
 	};
 
 	struct TupleAssignExpr {
-		Ptr tup_left;
-		Ptr tup_right;
+		constexpr static AST::Kind node_kind = AST::Kind::TupleAssignExpr;
+		NodeId tup_left;
+		NodeId tup_right;
 	};
 
 	// - statements --
 	struct BlockStmt {
-		std::vector<Ptr> statements;
+		constexpr static AST::Kind node_kind = AST::Kind::BlockStmt;
+		List statements;
 	};
 
 	struct ReturnStmt {
-		Ptr expr;
+		constexpr static AST::Kind node_kind = AST::Kind::ReturnStmt;
+		NodeId expr;
 	};
 
 	struct VariableStmt {
+		constexpr static AST::Kind node_kind = AST::Kind::VariableStmt;
 		bool is_const{};
-		Name name{};
+		// set by semantic analysis when every use was replaced by the initializer
+		bool is_folded{};
+		Symbol sym{};
 		Type type{};
-		Ptr initializer{};
+		NodeId initializer{};
 	};
 
 	struct WhileStmt {
-		Ptr condition;
-		Ptr block;
+		constexpr static AST::Kind node_kind = AST::Kind::WhileStmt;
+		NodeId condition;
+		NodeId block;
 	};
 
 	struct IfStmt {
-		Ptr condition;
-		Ptr then_stmt;
-		Ptr else_stmt;
+		constexpr static AST::Kind node_kind = AST::Kind::IfStmt;
+		NodeId condition;
+		NodeId then_stmt;
+		NodeId else_stmt;
 	};
 
-	using Top = std::variant<Function, Root, ParameterList>;
+	// The nodes of one function. Children are added before their parents,
+	// so the function node is always the last one.
+	class Tree {
+	public:
+		Tree() { clear(); }
 
-	using Expr = std::variant<
-		BinaryExpr,
-		IdentifierExpr,
-		LiteralExpr,
-		AssignExpr,
-		WhileExpr,
-		IfExpr,
-		TupleExpr,
-		TupleAssignExpr>;
+		template <typename T>
+		NodeId add(const T& payload) {
+			auto& table = std::get<std::vector<T>>(payloads);
+			const auto id = static_cast<NodeId>(kinds.size());
+			kinds.push_back(T::node_kind);
+			indices.push_back(static_cast<std::uint32_t>(table.size()));
+			table.push_back(payload);
+			return id;
+		}
 
-	using Stmt = std::variant<
-		BlockStmt,
-		ReturnStmt,
-		VariableStmt,
-		WhileStmt,
-		IfStmt>;
+		List add_list(std::span<const NodeId> items) {
+			const List list{ static_cast<std::uint32_t>(list_items.size()), static_cast<std::uint32_t>(items.size()) };
+			list_items.insert(list_items.end(), items.begin(), items.end());
+			return list;
+		}
+
+		Kind kind(const NodeId id) const { return kinds[id]; }
 
-	std::variant<Top, Expr, Stmt> data;
-	std::optional<Symbol> sym;
+		template <typename T>
+		const T& get(const NodeId id) const {
+			if (kinds[id] != T::node_kind) throw std::runtime_error("internal error: AST node is of another kind");
+			return std::get<std::vector<T>>(payloads)[indices[id]];
+		}
+
+		template <typename T>
+		T& get(const NodeId id) {
+			return const_cast<T&>(std::as_const(*this).get<T>(id));
+		}
+
+		// turns a node into another one in place, parents keep referring to it
+		template <typename T>
+		void replace(const NodeId id, const T& payload) {
+			auto& table = std::get<std::vector<T>>(payloads);
+			kinds[id] = T::node_kind;
+			indices[id] = static_cast<std::uint32_t>(table.size());
+			table.push_back(payload);
+		}
+
+		// makes a node share the kind and payload of another
+		void alias(const NodeId id, const NodeId other) {
+			kinds[id] = kinds[other];
+			indices[id] = indices[other];
+		}
+
+		std::span<const NodeId> list(const List& list) const {
+			return { list_items.data() + list.first, list.size };
+		}
+
+		NodeId root() const { return static_cast<NodeId>(kinds.size() - 1); }
+		std::size_t size() const { return kinds.size(); }
+
+		// renames every symbol through map, for trees parsed with another interner
+		void remap_symbols(std::span<const SymbolId> map) {
+			for (auto& x : std::get<std::vector<Function>>(payloads)) x.name = map[x.name];
+			for (auto& x : std::get<std::vector<IdentifierExpr>>(payloads)) x.sym.name = map[x.sym.name];
+			for (auto& x : std::get<std::vector<VariableStmt>>(payloads)) x.sym.name = map[x.sym.name];
+		}
+
+		// drops every node but keeps the memory
+		void clear() {
+			kinds.clear();
+			indices.clear();
+			list_items.clear();
+			std::apply([](auto&... table) { (table.clear(), ...); }, payloads);
+			kinds.push_back(Kind::None);
+			indices.push_back(0);
+		}
+
+	private:
+		std::vector<Kind> kinds;
+		// position of each node in the payload table of its kind
+		std::vector<std::uint32_t> indices;
+		std::vector<NodeId> list_items;
+		std::tuple<
+			std::vector<Function>,
+			std::vector<ParameterList>,
+			std::vector<BinaryExpr>,
+			std::vector<IdentifierExpr>,
+			std::vector<LiteralExpr>,
+			std::vector<AssignExpr>,
+			std::vector<WhileExpr>,
+			std::vector<IfExpr>,
+			std::vector<TupleExpr>,
+			std::vector<TupleAssignExpr>,
+			std::vector<BlockStmt>,
+			std::vector<ReturnStmt>,
+			std::vector<VariableStmt>,
+			std::vector<WhileStmt>,
+			std::vector<IfStmt>> payloads;
+	};
+
+	struct Root {
+		// one tree per function, in source order
+		std::vector<Tree> functions;
+	};
 };
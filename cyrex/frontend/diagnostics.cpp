@@ -0,0 +1,48 @@
+#include "diagnostics.hpp"
+#include "source.hpp"
+#include <algorithm>
+#include <format>
+
+LineTable::LineTable(const std::string_view text) {
+	line_starts.push_back(0);
+	for (auto pos = text.find('\n'); pos != std::string_view::npos; pos = text.find('\n', pos + 1)) {
+		line_starts.push_back(static_cast<SourceLoc>(pos + 1));
+	}
+}
+
+LineTable::Position LineTable::position(const SourceLoc loc) const {
+	// the last line starting at or before loc
+	const auto it = std::prev(std::upper_bound(line_starts.begin(), line_starts.end(), loc));
+	return {
+		.line = static_cast<std::uint32_t>(it - line_starts.begin()) + 1,
+		.column = loc - *it + 1 };
+}
+
+std::string Diagnostics::message(const Diagnostic& diagnostic) {
+	const auto arg_text = [](const DiagArg& arg) {
+		return std::visit([](const auto& x) -> std::string {
+			using T = std::decay_t<decltype(x)>;
+			if constexpr (std::same_as<T, std::monostate>) {
+				return {};
+			} else if constexpr (std::same_as<T, std::string_view>) {
+				return std::string(x);
+			} else {
+				return std::to_string(x);
+			}
+		}, arg);
+	};
+
+	const std::string arg0 = arg_text(diagnostic.args[0]);
+	const std::string arg1 = arg_text(diagnostic.args[1]);
+	return std::vformat(diag_message(diagnostic.id), std::make_format_args(arg0, arg1));
+}
+
+void Diagnostics::print(std::ostream& os, const SourceBuffer& source) const {
+	if (list.empty()) return;
+
+	const LineTable lines(source.text());
+	for (const auto& diagnostic : list) {
+		const auto [line, column] = lines.position(diagnostic.loc);
+		os << std::format("{}:{}:{}: error: {}\n", source.filename(), line, column, message(diagnostic));
+	}
+}
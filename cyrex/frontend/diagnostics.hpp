@@ -0,0 +1,152 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+class SourceBuffer;
+
+// Byte offset into a source buffer
+using SourceLoc = std::uint32_t;
+
+enum class DiagId : std::uint8_t {
+	// lexer
+	UnexpectedCharacter,
+	UnterminatedString,
+	// parser
+	ExpectedFunction,
+	UnexpectedInStatement,
+	ExpectedTupleExpression,
+	ExpectedTupleComma,
+	ExpectedTupleClose,
+	EmptyTuple,
+	WrongTupleSize,
+	ExpectedTupleOpen,
+	ExpectedTupleAssignment,
+	ExpectedThen,
+	ExpectedElse,
+	UnexpectedBraceAfterWhile,
+	UnexpectedAfterWhileCondition,
+	ExpectedFunctionName,
+	ExpectedFunctionParen,
+	ExpectedFunctionColon,
+	ExpectedReturnType,
+	ExpectedFunctionBlock,
+	ErrorParsingBlock,
+	ExpectedStatement,
+	ExpectedConstOrVar,
+	ExpectedVariableName,
+	ExpectedVariableColon,
+	ExpectedVariableType,
+	ConstWithoutInitializer,
+	ExpectedInitializer,
+	ExpectedBinaryRhs,
+	ExpectedArraySize,
+	ExpectedArrayClose,
+	TooManyQualifiers,
+	NumberOutOfRange,
+	// semantic analysis
+	UndefinedSymbol,
+	Redefinition,
+	AssignToConst,
+	NotAssignable,
+	ParameterUse,
+};
+
+// The message of a diagnostic, {} are filled in from its arguments
+constexpr std::string_view diag_message(const DiagId id) {
+	switch (id) {
+		case DiagId::UnexpectedCharacter: return "unexpected character {}";
+		case DiagId::UnterminatedString: return "unterminated string";
+		case DiagId::ExpectedFunction: return "expected 'function'";
+		case DiagId::UnexpectedInStatement: return "unexpected {} in statement";
+		case DiagId::ExpectedTupleExpression: return "expected expression in tuple";
+		case DiagId::ExpectedTupleComma: return "expected comma after expression";
+		case DiagId::ExpectedTupleClose: return "expected ] to close tuple";
+		case DiagId::EmptyTuple: return "tuple cannot be empty";
+		case DiagId::WrongTupleSize: return "tuple must have exactly {} terms";
+		case DiagId::ExpectedTupleOpen: return "expected [ for tuple";
+		case DiagId::ExpectedTupleAssignment: return "expected tuple for tuple assignment";
+		case DiagId::ExpectedThen: return "expected 'then' for if-expression";
+		case DiagId::ExpectedElse: return "expected else after if-expression";
+		case DiagId::UnexpectedBraceAfterWhile: return "unexpected { after while statement";
+		case DiagId::UnexpectedAfterWhileCondition: return "unexpected {} after while condition";
+		case DiagId::ExpectedFunctionName: return "expected name of function";
+		case DiagId::ExpectedFunctionParen: return "expected ( after function {}'s name";
+		case DiagId::ExpectedFunctionColon: return "expected : after function {}'s parameters";
+		case DiagId::ExpectedReturnType: return "expected return type for function {} after :";
+		case DiagId::ExpectedFunctionBlock: return "expected {{ to begin function {}'s block";
+		case DiagId::ErrorParsingBlock: return "error parsing block";
+		case DiagId::ExpectedStatement: return "expected statement in function body";
+		case DiagId::ExpectedConstOrVar: return "expected either const or var";
+		case DiagId::ExpectedVariableName: return "expected variable name";
+		case DiagId::ExpectedVariableColon: return "expected : after variable name";
+		case DiagId::ExpectedVariableType: return "expected variable type after :";
+		case DiagId::ConstWithoutInitializer: return "{} is const so it must be initialized";
+		case DiagId::ExpectedInitializer: return "expected expression for variable initializer";
+		case DiagId::ExpectedBinaryRhs: return "expected expression in right hand side of binary expression";
+		case DiagId::ExpectedArraySize: return "expected array size";
+		case DiagId::ExpectedArrayClose: return "expected ]";
+		case DiagId::TooManyQualifiers: return "types may have at most {} pointer or array qualifiers";
+		case DiagId::NumberOutOfRange: return "number {} is out of range";
+		case DiagId::UndefinedSymbol: return "symbol {} is undefined";
+		case DiagId::Redefinition: return "variable {} already defined in scope";
+		case DiagId::AssignToConst: return "cannot assign to {} because it is const";
+		case DiagId::NotAssignable: return "left hand side of assignment is not assignable";
+		case DiagId::ParameterUse: return "parameter {} cannot be used yet";
+	}
+	return "unknown error";
+}
+
+// Text arguments point into the source buffer, which outlives its diagnostics
+using DiagArg = std::variant<std::monostate, std::string_view, std::int64_t>;
+
+// A diagnostic is recorded without formatting anything.
+// The message is only built if the diagnostic is printed.
+struct Diagnostic {
+	DiagId id{};
+	SourceLoc loc{};
+	std::array<DiagArg, 2> args{};
+};
+
+// Maps source offsets to 1-based lines and columns
+class LineTable {
+public:
+	struct Position {
+		std::uint32_t line{};
+		std::uint32_t column{};
+	};
+
+	explicit LineTable(const std::string_view text);
+	Position position(const SourceLoc loc) const;
+
+private:
+	// offset of the first character of every line
+	std::vector<SourceLoc> line_starts;
+};
+
+class Diagnostics {
+public:
+	void report(const DiagId id, const SourceLoc loc, const DiagArg& arg0 = {}, const DiagArg& arg1 = {}) {
+		list.push_back({ .id = id, .loc = loc, .args = { arg0, arg1 } });
+	}
+
+	// adds the diagnostics of other after ours
+	void append(const Diagnostics& other) {
+		list.insert(list.end(), other.list.begin(), other.list.end());
+	}
+
+	bool has_errors() const { return !list.empty(); }
+	const std::vector<Diagnostic>& get() const { return list; }
+	void clear() { list.clear(); }
+
+	static std::string message(const Diagnostic& diagnostic);
+	// file:line:column: error: message
+	void print(std::ostream& os, const SourceBuffer& source) const;
+
+private:
+	std::vector<Diagnostic> list;
+};
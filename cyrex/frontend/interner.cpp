@@ -0,0 +1,29 @@
+#include "interner.hpp"
+#include <algorithm>
+
+SymbolId Interner::intern(const std::string_view text) {
+	if (auto it = ids.find(text); it != ids.end()) {
+		return it->second;
+	}
+	const auto id = static_cast<SymbolId>(spellings.size());
+	const auto stored = store(text);
+	spellings.push_back(stored);
+	ids.emplace(stored, id);
+	return id;
+}
+
+std::string_view Interner::spelling(const SymbolId id) const {
+	return spellings.at(id);
+}
+
+std::string_view Interner::store(const std::string_view text) {
+	// identifiers longer than a chunk get a chunk of their own
+	if (chunk_used + text.size() > chunk_size) {
+		chunks.push_back(std::make_unique<char[]>(std::max(chunk_size, text.size())));
+		chunk_used = 0;
+	}
+	char* dst = chunks.back().get() + chunk_used;
+	std::copy(text.begin(), text.end(), dst);
+	chunk_used += text.size();
+	return { dst, text.size() };
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+// Dense id of an interned identifier
+using SymbolId = std::uint32_t;
+
+// Maps each distinct identifier to a SymbolId, shared by every stage of a
+// compilation so that names compare and hash as integers.
+// Spellings are copied into storage owned by the interner, so ids outlive
+// the source buffer they were lexed from.
+class Interner {
+public:
+	SymbolId intern(const std::string_view text);
+	std::string_view spelling(const SymbolId id) const;
+	std::size_t size() const { return spellings.size(); }
+
+private:
+	std::string_view store(const std::string_view text);
+
+private:
+	constexpr static std::size_t chunk_size = 64 * 1024;
+
+	std::unordered_map<std::string_view, SymbolId> ids;
+	std::vector<std::string_view> spellings;
+	std::vector<std::unique_ptr<char[]>> chunks;
+	std::size_t chunk_used = chunk_size;
+};
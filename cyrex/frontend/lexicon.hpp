@@ -0,0 +1,59 @@
+#pragma once
+#include "token.hpp"
+
+// The reserved words and punctuation of the language.
+// Everything here is built at compile time, so none of it needs
+// initializing at startup.
+
+inline constexpr auto keyword_spellings = std::to_array<TokenSpelling>({
+	// -- keywords --
+	{"function", Token::Type::Function},
+	{"return", Token::Type::Return},
+	{"while", Token::Type::While},
+	{"if", Token::Type::If},
+	{"then", Token::Type::Then},
+	{"else", Token::Type::Else},
+	{"const", Token::Type::Const},
+	{"var", Token::Type::Var},
+	{"inline", Token::Type::Inline},
+	{"do", Token::Type::Do},
+	// types
+	{"void", Token::Type::Void},
+	{"char", Token::Type::Char},
+	{"short", Token::Type::Short},
+	{"int", Token::Type::Int},
+	{"long", Token::Type::Long},
+});
+
+inline constexpr auto punctuation_spellings = std::to_array<TokenSpelling>({
+	// -- punctuation --
+	{"(", Token::Type::LeftParen},
+	{")", Token::Type::RightParen},
+	{"[", Token::Type::LeftSqBracket},
+	{"]", Token::Type::RightSqBracket},
+	{":", Token::Type::Colon},
+	{"{", Token::Type::LeftBrace},
+	{"}", Token::Type::RightBrace},
+	{"=", Token::Type::Assign},
+	{",", Token::Type::Comma},
+	// logic
+	{"&", Token::Type::And},
+	{"|", Token::Type::Or},
+	{"^", Token::Type::Xor},
+	{"!", Token::Type::Not},
+	// arithmetic
+	{"+", Token::Type::Plus},
+	{"-", Token::Type::Minus},
+	{"*", Token::Type::Star},
+	{"/", Token::Type::Slash},
+	// comparison
+	{"<",  Token::Type::Lesser},
+	{">",  Token::Type::Greater},
+	{"<=", Token::Type::LesserOrEqual},
+	{">=", Token::Type::GreaterOrEqual},
+	{"==", Token::Type::Equal},
+	{"!=", Token::Type::NotEqual},
+});
+
+inline constexpr SpellingTable keywords{ keyword_spellings };
+inline constexpr PunctuationTrie punctuation_trie{ punctuation_spellings };
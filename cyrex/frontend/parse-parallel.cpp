@@ -0,0 +1,134 @@
+#include "parse-parallel.hpp"
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+
+// A piece is cut at the first function end after this many bytes
+constexpr static std::size_t piece_size = 64 * 1024;
+
+struct Piece {
+	std::string_view text;
+	SourceLoc origin{};
+	Interner interner;
+	Diagnostics diagnostics;
+	AST::Root root;
+	std::exception_ptr error;
+};
+
+std::vector<std::size_t> function_ends(const std::string_view src) {
+	std::vector<std::size_t> ends;
+	std::size_t depth = 0;
+	for (std::size_t i = 0; i < src.size(); ++i) {
+		switch (src[i]) {
+			case '\"': {
+				// like the lexer, a string ends at the next quote
+				const auto close = src.find('\"', i + 1);
+				if (close == std::string_view::npos) return ends;
+				i = close;
+				break;
+			}
+			case '{':
+			++depth;
+			break;
+			case '}':
+			if (depth > 0 && --depth == 0) ends.push_back(i + 1);
+			break;
+		}
+	}
+	return ends;
+}
+
+struct PieceText {
+	std::string_view text;
+	// functions in the piece, as far as braces tell
+	std::size_t num_functions{};
+};
+
+static std::vector<PieceText> cut_pieces(const std::string_view src) {
+	std::vector<PieceText> pieces;
+	std::size_t begin = 0;
+	std::size_t num_functions = 0;
+	for (const auto end : function_ends(src)) {
+		++num_functions;
+		if (end - begin >= piece_size) {
+			pieces.push_back({ src.substr(begin, end - begin), num_functions });
+			begin = end;
+			num_functions = 0;
+		}
+	}
+	// the rest, which may be only whitespace or unbalanced
+	pieces.push_back({ src.substr(begin), num_functions });
+	return pieces;
+}
+
+void parse_parallel(
+	const std::string_view src,
+	const SpellingTable& keywords,
+	const PunctuationTrie& punctuation,
+	Interner& interner,
+	Diagnostics& diagnostics,
+	AST::Root& root,
+	const unsigned num_threads
+) {
+	const auto texts = cut_pieces(src);
+	if (texts.size() == 1) {
+		Lexer lexer(src, keywords, punctuation, interner, diagnostics);
+		Parser parser{ diagnostics };
+		parser.parse(lexer, root);
+		return;
+	}
+
+	// hand the trees of the last file to the pieces, so their memory is reused
+	std::vector<Piece> pieces(texts.size());
+	auto spare_tree = root.functions.begin();
+	for (std::size_t i = 0; i < texts.size(); ++i) {
+		pieces[i].text = texts[i].text;
+		pieces[i].origin = static_cast<SourceLoc>(texts[i].text.data() - src.data());
+		auto& trees = pieces[i].root.functions;
+		while (trees.size() < texts[i].num_functions && spare_tree != root.functions.end()) {
+			trees.push_back(std::move(*spare_tree++));
+		}
+	}
+
+	std::atomic<std::size_t> next_piece{ 0 };
+	const auto work = [&]() {
+		for (std::size_t i; (i = next_piece++) < pieces.size();) {
+			auto& piece = pieces[i];
+			try {
+				Lexer lexer(piece.text, keywords, punctuation, piece.interner, piece.diagnostics, Scanner::best(), piece.origin);
+				Parser parser{ piece.diagnostics };
+				parser.parse(lexer, piece.root);
+			} catch (...) {
+				piece.error = std::current_exception();
+			}
+		}
+	};
+
+	{
+		const std::size_t num_workers = std::clamp<std::size_t>(num_threads, 1, pieces.size());
+		std::vector<std::jthread> workers;
+		for (std::size_t i = 1; i < num_workers; ++i) {
+			workers.emplace_back(work);
+		}
+		work();
+	}
+
+	// merging in source order interns names in the order a single parser
+	// would have met them, so they get the same ids
+	root.functions.clear();
+	std::vector<SymbolId> symbol_map;
+	for (auto& piece : pieces) {
+		if (piece.error) std::rethrow_exception(piece.error);
+
+		symbol_map.clear();
+		for (SymbolId id = 0; id < piece.interner.size(); ++id) {
+			symbol_map.push_back(interner.intern(piece.interner.spelling(id)));
+		}
+		for (auto& tree : piece.root.functions) {
+			tree.remap_symbols(symbol_map);
+			root.functions.push_back(std::move(tree));
+		}
+		diagnostics.append(piece.diagnostics);
+	}
+}
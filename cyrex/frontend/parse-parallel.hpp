@@ -0,0 +1,22 @@
+#pragma once
+#include "parser.hpp"
+#include <vector>
+
+// Offsets just past every '}' that closes a brace opened at the top level,
+// which is where top-level functions end. Braces in strings are skipped.
+std::vector<std::size_t> function_ends(const std::string_view src);
+
+// Parses src into root like Parser::parse, on up to num_threads threads.
+// The source is cut into pieces of whole functions that are lexed and
+// parsed independently, each with its own interner and diagnostics. The
+// pieces are then merged in source order, so symbol ids and diagnostics
+// do not depend on the number of threads.
+void parse_parallel(
+	const std::string_view src,
+	const SpellingTable& keywords,
+	const PunctuationTrie& punctuation,
+	Interner& interner,
+	Diagnostics& diagnostics,
+	AST::Root& root,
+	const unsigned num_threads
+);
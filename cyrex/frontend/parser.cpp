@@ -1,54 +1,80 @@
 #include "parser.hpp"
 #include <optional>
-#include <format>
+#include <charconv>
 
 template<typename T>
-static AST::Ptr make_ast(T&& val, std::optional<AST::Symbol> sym = std::nullopt) {
-	return AST::Ptr(new AST{ .data = std::move(val), .sym = sym });
+AST::NodeId Parser::make_ast(const T& val) {
+	return tree->add(val);
+}
+
+AST::List Parser::ListBuilder::finish() const {
+	return parser.tree->add_list({ parser.scratch.data() + mark, size() });
 }
 
 
-constexpr Parser::Error::Error(const std::string& message) : message(message) {
+Parser::Parser(Diagnostics& diagnostics) : diagnostics(diagnostics) {
 }
 
-bool Parser::is_at_end() const {
-	return index >= tokens.size();
+bool Parser::is_at_end() {
+	return lexer->is_at_end();
 }
 
-const Token& Parser::current_token() const {
-	return tokens[index];
+const Token& Parser::current_token() {
+	return lexer->peek();
 }
 
-bool Parser::check(const Token::Type type) const {
+bool Parser::check(const Token::Type type) {
 	return !is_at_end() && current_token().type == type;
 }
 
-bool Parser::check_binary() const {
-	const auto current = current_token().type;
-	switch (current) {
-		case Token::Type::Equal:
-		case Token::Type::NotEqual:
-		case Token::Type::Lesser:
-		case Token::Type::LesserOrEqual:
-		case Token::Type::Greater:
-		case Token::Type::GreaterOrEqual:
-		case Token::Type::And:
-		case Token::Type::Or:
-		case Token::Type::Xor:
-		case Token::Type::Plus:
-		case Token::Type::Minus:
-		return true;
-	}
-	return false;
+// * and / are not binary operators: BinaryExpr has no kinds for them, so an
+// expression ends before them and the statement reports the token
+static std::optional<AST::BinaryExpr::Kind> binary_kind(const Token::Type type) {
+	switch (type) {
+		case Token::Type::Lesser: return AST::BinaryExpr::Kind::CmpLesser;
+		case Token::Type::LesserOrEqual: return AST::BinaryExpr::Kind::CmpLesserOrEqual;
+		case Token::Type::Greater: return AST::BinaryExpr::Kind::CmpGreater;
+		case Token::Type::GreaterOrEqual: return AST::BinaryExpr::Kind::CmpGreaterOrEqual;
+		case Token::Type::Equal: return AST::BinaryExpr::Kind::CmpEqual;
+		case Token::Type::NotEqual: return AST::BinaryExpr::Kind::CmpNotEqual;
+		case Token::Type::And: return AST::BinaryExpr::Kind::CmpAnd;
+		case Token::Type::Or: return AST::BinaryExpr::Kind::CmpOr;
+		case Token::Type::Xor: return AST::BinaryExpr::Kind::CmpXor;
+		case Token::Type::Plus: return AST::BinaryExpr::Kind::Add;
+		case Token::Type::Minus: return AST::BinaryExpr::Kind::Sub;
+	}
+	return std::nullopt;
+}
+
+// How tightly an operator binds, as in C. Every level is left associative.
+static int precedence(const AST::BinaryExpr::Kind kind) {
+	switch (kind) {
+		case AST::BinaryExpr::Kind::CmpOr: return 1;
+		case AST::BinaryExpr::Kind::CmpXor: return 2;
+		case AST::BinaryExpr::Kind::CmpAnd: return 3;
+		case AST::BinaryExpr::Kind::CmpEqual:
+		case AST::BinaryExpr::Kind::CmpNotEqual: return 4;
+		case AST::BinaryExpr::Kind::CmpLesser:
+		case AST::BinaryExpr::Kind::CmpLesserOrEqual:
+		case AST::BinaryExpr::Kind::CmpGreater:
+		case AST::BinaryExpr::Kind::CmpGreaterOrEqual: return 5;
+		case AST::BinaryExpr::Kind::Add:
+		case AST::BinaryExpr::Kind::Sub: return 6;
+	}
+	throw std::runtime_error("internal error: binary operator without a precedence");
+}
+
+bool Parser::check_binary() {
+	return binary_kind(current_token().type).has_value();
 }
 
-bool Parser::expect(const Token::Type type, const std::string& error_message) {
+bool Parser::expect(const Token::Type type, const DiagId error, const DiagArg& arg) {
 	bool same = check(type);
-	if (!same) push_error(std::string(error_message));
+	if (!same) push_error(error, arg);
 	return same;
 }
 
-bool Parser::expect_data_type(const std::string& error_message) {
+bool Parser::expect_data_type(const DiagId error, const DiagArg& arg) {
 	const Token& current = current_token();
 	switch (current.type) {
 		case Token::Type::Void:
@@ -60,52 +86,48 @@ bool Parser::expect_data_type(const std::string& error_message) {
 		case Token::Type::Identifier:
 		return true;
 	}
-	push_error(error_message);
+	push_error(error, arg);
 	return false;
 }
 
 Token Parser::next() {
-	return tokens[index++];
+	return lexer->next();
 }
 
-void Parser::push_error(const std::string& error_message) {
-	errors.emplace_back(error_message);
+void Parser::push_error(const DiagId error, const DiagArg& arg) {
+	diagnostics.report(error, current_token().loc, arg);
 }
 
-AST::Ptr Parser::parse(const std::vector<Token>& tokens) {
-	this->tokens = tokens;
-	this->errors.clear();
-	this->errors.shrink_to_fit();
-	this->index = 0;
-	auto root = AST::Root{};
+void Parser::parse(Lexer& lexer, AST::Root& root) {
+	this->lexer = &lexer;
+	std::size_t num_functions = 0;
 
 	while (!is_at_end()) {
+		if (num_functions == root.functions.size()) {
+			root.functions.emplace_back();
+		}
+		tree = &root.functions[num_functions];
+		tree->clear();
+
 		auto ast = parse_top();
 		if (!ast) { break; }
-		root.functions.emplace_back(std::move(ast));
+		++num_functions;
 	}
 
-	return make_ast(root);
+	root.functions.resize(num_functions);
+	tree = nullptr;
 }
 
-bool Parser::has_errors() const {
-	return !errors.empty();
-}
-
-const std::vector<Parser::Error>& Parser::get_errors() const {
-	return errors;
-}
-
-AST::Ptr Parser::parse_top() {
+AST::NodeId Parser::parse_top() {
 	if (check(Token::Type::Function)) {
 		next();
 		return parse_function();
 	}
-	push_error("expected 'function'");
-	return nullptr;
+	push_error(DiagId::ExpectedFunction);
+	return AST::NoNode;
 }
 
-AST::Ptr Parser::parse_stmt() {
+AST::NodeId Parser::parse_stmt() {
 	if (check(Token::Type::If)) {
 		next();
 		return parse_if(Context::Statement);
@@ -132,25 +154,21 @@ AST::Ptr Parser::parse_stmt() {
 		return parse_tuple();
 	}
 
-	push_error(std::format("unexpected {} in statement", current_token().text));
-	return nullptr;
+	push_error(DiagId::UnexpectedInStatement, current_token().text);
+	return AST::NoNode;
 }
 
-AST::Ptr Parser::parse_expr() {
+AST::NodeId Parser::parse_expr() {
 	if (check(Token::Type::Number)) {
-		return parse_number();
+		return parse_binary(parse_number());
 	}
 
 	if (check(Token::Type::String)) {
-		return make_ast(AST::LiteralExpr{ .type =
-			AST::Type{
-				.name = "byte",
-				.qualifiers = {
-					AST::Type::Qualifier{
-						.kind = AST::Type::Qualifier::Kind::Pointer
-					}
-				}
-			}, .value = next().text });
+		AST::Type type{ .name = "byte" };
+		type.add_qualifier(AST::Type::Qualifier{
+			.kind = AST::Type::Qualifier::Kind::Pointer
+		});
+		return make_ast(AST::LiteralExpr{ .type = type, .value = next().text });
 
 	}
 
@@ -173,84 +191,80 @@ AST::Ptr Parser::parse_expr() {
 		return parse_tuple();
 	}
 
-	return nullptr;
+	return AST::NoNode;
 }
 
-AST::Ptr Parser::parse_tuple(const int size_limit) {
-	std::vector<AST::Ptr> exprs;
+AST::NodeId Parser::parse_tuple(const int size_limit) {
+	ListBuilder exprs{ *this };
 
 	while (!check(Token::Type::RightSqBracket)) {
 		auto expr = parse_expr();
 
 		if (!expr) {
-			push_error("expected expression in tuple");
-			return nullptr;
+			push_error(DiagId::ExpectedTupleExpression);
+			return AST::NoNode;
 		}
-		exprs.push_back(std::move(expr));
+		exprs.push(expr);
 		if (check(Token::Type::RightSqBracket)) break;
 
-		if (!expect(Token::Type::Comma, "expected comma after expression")) {
-			return nullptr;
+		if (!expect(Token::Type::Comma, DiagId::ExpectedTupleComma)) {
+			return AST::NoNode;
 		}
 		next();
 	}
 
-	if (!expect(Token::Type::RightSqBracket, "expected ] to close tuple")) {
-		return nullptr;
+	if (!expect(Token::Type::RightSqBracket, DiagId::ExpectedTupleClose)) {
+		return AST::NoNode;
 	}
 	next();
 
-	if (exprs.empty()) {
-		push_error("tuple cannot be empty");
-		return nullptr;
+	if (exprs.size() == 0) {
+		push_error(DiagId::EmptyTuple);
+		return AST::NoNode;
 	}
 
 	if (size_limit != -1 && exprs.size() != size_limit) {
-		push_error(std::format("tuple must have exactly {} terms", size_limit));
-		return nullptr;
+		push_error(DiagId::WrongTupleSize, std::int64_t{ size_limit });
+		return AST::NoNode;
 	}
 
 	size_t nexprs = exprs.size();
 
-	auto tuple = make_ast(AST::TupleExpr{ .exprs = std::move(exprs) });
+	auto tuple = make_ast(AST::TupleExpr{ .exprs = exprs.finish() });
 
 	// [a,b] = [b,a]
 	if (check(Token::Type::Assign)) {
 		next();
-		if (!expect(Token::Type::LeftSqBracket, "expected [ for tuple")) {
-			return nullptr;
+		if (!expect(Token::Type::LeftSqBracket, DiagId::ExpectedTupleOpen)) {
+			return AST::NoNode;
 		}
 		next();
 
 		auto rhs = parse_tuple(nexprs);
 
-		if (rhs == nullptr) {
-			push_error("expected tuple for tuple assignment");
-			return nullptr;
+		if (rhs == AST::NoNode) {
+			push_error(DiagId::ExpectedTupleAssignment);
+			return AST::NoNode;
 		}
 
 		return make_ast(AST::TupleAssignExpr{
-			.tup_left = std::move(tuple),
-			.tup_right = std::move(rhs) });
-	}
-
-	if (tuple == nullptr) {
-
+			.tup_left = tuple,
+			.tup_right = rhs });
 	}
 
 	return tuple;
 
 }
 
-AST::Ptr Parser::parse_if(Context context) {
+AST::NodeId Parser::parse_if(Context context) {
 	auto condition = parse_expr();
-	if (!condition) return nullptr;
+	if (!condition) return AST::NoNode;
 
 	// it is a block-if
 	if (check(Token::Type::LeftBrace)) {
 		next();
-		AST::Ptr then_block = parse_block();
-		AST::Ptr else_block = nullptr;
+		AST::NodeId then_block = parse_block();
+		AST::NodeId else_block = AST::NoNode;
 		if (check(Token::Type::Else)) {
 			next();
 			if (check(Token::Type::LeftBrace)) {
@@ -259,20 +273,20 @@ AST::Ptr Parser::parse_if(Context context) {
 			} else {
 				else_block = parse_stmt();
 			}
-			if (!else_block) return nullptr;
+			if (!else_block) return AST::NoNode;
 		}
 		return make_ast(AST::IfStmt{
-			.condition = std::move(condition),
-			.then_stmt = std::move(then_block),
-			.else_stmt = std::move(else_block) });
+			.condition = condition,
+			.then_stmt = then_block,
+			.else_stmt = else_block });
 	}
 
 	// it is a statement if
 	if (check(Token::Type::Do)) {
 		next();
 
-		AST::Ptr then_stmt = parse_stmt();
-		AST::Ptr else_stmt = nullptr;
+		AST::NodeId then_stmt = parse_stmt();
+		AST::NodeId else_stmt = AST::NoNode;
 
 		if (check(Token::Type::Else)) {
 			next();
@@ -280,35 +294,35 @@ AST::Ptr Parser::parse_if(Context context) {
 		}
 
 		return make_ast(AST::IfStmt{
-			.condition = std::move(condition),
-			.then_stmt = std::move(then_stmt),
-			.else_stmt = std::move(else_stmt) });
+			.condition = condition,
+			.then_stmt = then_stmt,
+			.else_stmt = else_stmt });
 	}
 
-	if (!expect(Token::Type::Then, "expected 'then' for if-expression")) {
-		return nullptr;
+	if (!expect(Token::Type::Then, DiagId::ExpectedThen)) {
+		return AST::NoNode;
 	}
 	next();
 
 	// it is an if-expression
 	auto then_expr = parse_expr();
-	if (!then_expr) return nullptr;
+	if (!then_expr) return AST::NoNode;
 
-	if (!expect(Token::Type::Else, "expected else after if-expression")) return nullptr;
+	if (!expect(Token::Type::Else, DiagId::ExpectedElse)) return AST::NoNode;
 	next();
 
 	auto else_expr = parse_expr();
-	if (!else_expr) return nullptr;
+	if (!else_expr) return AST::NoNode;
 
 	return make_ast(AST::IfExpr{
-		.condition = std::move(condition),
-		.then_expr = std::move(then_expr),
-		.else_expr = std::move(else_expr) });
+		.condition = condition,
+		.then_expr = then_expr,
+		.else_expr = else_expr });
 }
 
-AST::Ptr Parser::parse_while(Context context) {
+AST::NodeId Parser::parse_while(Context context) {
 	auto condition = parse_expr();
-	if (!condition) return nullptr;
+	if (!condition) return AST::NoNode;
 
 	if (check(Token::Type::LeftBrace)) {
 		next();
@@ -316,101 +330,103 @@ AST::Ptr Parser::parse_while(Context context) {
 		if (check(Token::Type::Then)) {
 			next();
 			auto expr = parse_expr();
-			if (!expr) return nullptr;
+			if (!expr) return AST::NoNode;
 			// while condition {...} then expr
 			return make_ast(AST::WhileExpr{
-				.condition = std::move(condition),
-				.block = std::move(block),
-				.returns = std::move(expr)
+				.condition = condition,
+				.block = block,
+				.returns = expr
 				});
 		}
 
 		// standard C style while loop
 		return make_ast(AST::WhileStmt{
-			.condition = std::move(condition),
-			.block = std::move(block),
+			.condition = condition,
+			.block = block,
 			});
 	}
 
 	if (check(Token::Type::Do)) {
 		next();
 		if (check(Token::Type::LeftBrace)) {
-			push_error("unexpected { after while statement");
-			return nullptr;
+			push_error(DiagId::UnexpectedBraceAfterWhile);
+			return AST::NoNode;
 		}
 		auto stmt = parse_stmt();
-		if (!stmt) return nullptr;
+		if (!stmt) return AST::NoNode;
 
 		if (check(Token::Type::Then)) {
 			next();
 			// const y : int = while x < 10 x = x + 1 then x * 2
 			auto expr = parse_expr();
-			if (!expr) return nullptr;
+			if (!expr) return AST::NoNode;
 			return make_ast(AST::WhileExpr{
-				.condition = std::move(condition),
-				.block = std::move(stmt),
-				.returns = std::move(expr)
+				.condition = condition,
+				.block = stmt,
+				.returns = expr
 				});
 		}
 
 		// while x < 10 do ...
 		return make_ast(AST::WhileStmt{
-			.condition = std::move(condition),
-			.block = std::move(stmt),
+			.condition = condition,
+			.block = stmt,
 			});
 	}
 
-	push_error(std::format("unexpected {} after while condition", current_token().text));
-	return nullptr;
+	push_error(DiagId::UnexpectedAfterWhileCondition, current_token().text);
+	return AST::NoNode;
 }
 
-AST::Ptr Parser::parse_return() {
+AST::NodeId Parser::parse_return() {
 	AST::ReturnStmt ret{};
 	ret.expr = parse_expr();
-	return make_ast(std::move(ret));
+	return make_ast(ret);
 }
 
-AST::Ptr Parser::parse_function() {
+AST::NodeId Parser::parse_function() {
 	AST::Function function{};
 
 	// read function name
-	if (!expect(Token::Type::Identifier, "expected name of function")) {
-		return nullptr;
+	if (!expect(Token::Type::Identifier, DiagId::ExpectedFunctionName)) {
+		return AST::NoNode;
 	}
-	function.name = next().text;
+	const Token name = next();
+	function.name = name.sym;
 	// read parameters
-	if (!expect(Token::Type::LeftParen, std::format("expected ( after function {}'s name", function.name))) {
-		return nullptr;
+	if (!expect(Token::Type::LeftParen, DiagId::ExpectedFunctionParen, name.text)) {
+		return AST::NoNode;
 	}
 	next();
 	function.parameter_list = parse_parameters();
 	if (!function.parameter_list) {
-		return nullptr;
+		return AST::NoNode;
 	}
 	// read return type
-	if (!expect(Token::Type::Colon, std::format("expected : after function {}'s parameters", function.name))) {
-		return nullptr;
+	if (!expect(Token::Type::Colon, DiagId::ExpectedFunctionColon, name.text)) {
+		return AST::NoNode;
 	}
 	next();
-	if (!expect_data_type(std::format("expected return type for function {} after : ", function.name))) {
-		return nullptr;
+	if (!expect_data_type(DiagId::ExpectedReturnType, name.text)) {
+		return AST::NoNode;
 	}
 	function.return_type = parse_type();
 	// read body
-	if (!expect(Token::Type::LeftBrace, std::format("expected {{ to begin function {}'s block", function.name))) {
-		return nullptr;
+	if (!expect(Token::Type::LeftBrace, DiagId::ExpectedFunctionBlock, name.text)) {
+		return AST::NoNode;
 	}
 	next();
 	function.block = parse_block();
 	if (!function.block) {
-		push_error("error parsing block");
-		return nullptr;
+		push_error(DiagId::ErrorParsingBlock);
+		return AST::NoNode;
 	}
-	return make_ast(std::move(function));
+	return make_ast(function);
 }
 
-AST::Ptr Parser::parse_block() {
+AST::NodeId Parser::parse_block() {
 	AST::BlockStmt block{};
+	ListBuilder statements{ *this };
 	while (!is_at_end()) {
 		// found closing brace
 		if (check(Token::Type::RightBrace)) {
@@ -419,17 +435,19 @@ AST::Ptr Parser::parse_block() {
 		}
 		auto statement = parse_stmt();
 		if (!statement) {
-			push_error("expected statement in function body");
-			return nullptr;
+			push_error(DiagId::ExpectedStatement);
+			return AST::NoNode;
 		}
-		block.statements.emplace_back(std::move(statement));
+		statements.push(statement);
 	}
+	block.statements = statements.finish();
 
-	return make_ast(std::move(block));
+	return make_ast(block);
 }
 
-AST::Ptr Parser::parse_parameters() {
+AST::NodeId Parser::parse_parameters() {
 	AST::ParameterList params{};
+	ListBuilder items{ *this };
 	while (!is_at_end()) {
 		if (check(Token::Type::RightParen)) {
 			next();
@@ -437,9 +455,9 @@ AST::Ptr Parser::parse_parameters() {
 		}
 		auto variable = parse_variable(Context::ParameterList);
 		if (!variable) {
-			return nullptr;
+			return AST::NoNode;
 		}
-		params.items.emplace_back(std::move(variable));
+		items.push(variable);
 
 		if (check(Token::Type::Comma)) {
 			next();
@@ -451,15 +469,17 @@ AST::Ptr Parser::parse_parameters() {
 		}
 	}
 
-	return make_ast(std::move(params));
+	params.items = items.finish();
+	return make_ast(params);
 }
 
-AST::Ptr Parser::parse_variable(Context context) {
+AST::NodeId Parser::parse_variable(Context context) {
 	AST::VariableStmt variable{};
 	bool is_const = false;
 
 	// read constness
-	switch (next().type) {
+	const Token keyword = next();
+	switch (keyword.type) {
 		case Token::Type::Var:
 		is_const = false;
 		break;
@@ -467,108 +487,130 @@ AST::Ptr Parser::parse_variable(Context context) {
 		is_const = true;
 		break;
 		default:
-		push_error("expected either const or var");
-		return nullptr;
+		diagnostics.report(DiagId::ExpectedConstOrVar, keyword.loc);
+		return AST::NoNode;
 	}
 	variable.is_const = is_const;
 
 	// read name
-	if (!expect(Token::Type::Identifier, "expected variable name")) {
-		return nullptr;
+	if (!expect(Token::Type::Identifier, DiagId::ExpectedVariableName)) {
+		return AST::NoNode;
 	}
-	const std::string name = next().text;
-	variable.name = name;
+	const Token name = next();
+	variable.sym = AST::Symbol{ .name = name.sym, .is_assignable = !is_const, .loc = name.loc };
 
 	// read type
-	if (!expect(Token::Type::Colon, "expected : after variable name")) {
-		return nullptr;
+	if (!expect(Token::Type::Colon, DiagId::ExpectedVariableColon)) {
+		return AST::NoNode;
 	}
 	next();
-	if (!expect_data_type("expected variable type after :")) {
-		return nullptr;
+	if (!expect_data_type(DiagId::ExpectedVariableType)) {
+		return AST::NoNode;
 	}
 	variable.type = parse_type();
 	// enforce const has initializer
 	if (context != Context::ParameterList && variable.is_const && !check(Token::Type::Assign)) {
-		push_error(std::format("{} is const so it must be initialized", variable.name));
-		return nullptr;
+		push_error(DiagId::ConstWithoutInitializer, name.text);
+		return AST::NoNode;
 	}
 	// read initializer expression
 	if (check(Token::Type::Assign)) {
 		next();
 		auto expr = parse_expr();
 		if (!expr) {
-			push_error("expected expression for variable initializer");
-			return nullptr;
+			push_error(DiagId::ExpectedInitializer);
+			return AST::NoNode;
 		}
-		variable.initializer = std::move(expr);
+		variable.initializer = expr;
 	}
 
-	return make_ast(std::move(variable), AST::Symbol{ .name = name, .is_assignable = !is_const });
+	return make_ast(variable);
 }
 
-AST::Ptr Parser::parse_identifier() {
-	auto name = next().text;
-	auto ident = make_ast(AST::IdentifierExpr{ .name = name }, AST::Symbol{ .name = name });
-
-	if (check_binary()) {
-		return parse_binary(std::move(ident));
-	}
+AST::NodeId Parser::parse_identifier() {
+	const Token name = next();
+	auto ident = make_ast(AST::IdentifierExpr{ .sym = AST::Symbol{ .name = name.sym, .loc = name.loc } });
 
 	if (check(Token::Type::Assign)) {
-		next();
+		const Token assign = next();
 		auto expr = parse_expr();
-		if (!expr) return nullptr;
+		if (!expr) return AST::NoNode;
 		return make_ast(AST::AssignExpr{
-			.left = std::move(ident),
-			.expr = std::move(expr) });
+			.left = ident,
+			.expr = expr,
+			.loc = assign.loc });
 	}
 
-	return ident;
+	return parse_binary(ident);
 }
 
-AST::Ptr Parser::parse_number() {
-	auto num = make_ast(AST::LiteralExpr{ .type =
-		AST::Type {
-			.name = "int",
-			.qualifiers = {}
-		},
-		.value = next().text });
+AST::NodeId Parser::parse_number() {
+	const Token token = next();
+	std::int64_t number{};
+	const auto [end, ec] = std::from_chars(token.text.data(), token.text.data() + token.text.size(), number);
+	if (ec != std::errc{}) {
+		push_error(DiagId::NumberOutOfRange, token.text);
+	}
+	return make_ast(AST::LiteralExpr{
+		.type = AST::Type{ .name = "int" },
+		.value = token.text,
+		.number = number });
+}
 
-	if (check_binary()) {
-		return parse_binary(std::move(num));
+AST::NodeId Parser::parse_operand() {
+	if (check(Token::Type::Number)) {
+		return parse_number();
 	}
-
-	return num;
+	if (check(Token::Type::Identifier)) {
+		const Token name = next();
+		return make_ast(AST::IdentifierExpr{ .sym = AST::Symbol{ .name = name.sym, .loc = name.loc } });
+	}
+	return parse_expr();
 }
 
-AST::Ptr Parser::parse_binary(AST::Ptr&& left) {
-	const AST::BinaryExpr::Kind kind = [&]() {
-		switch (next().type) {
-			case Token::Type::Lesser: return AST::BinaryExpr::Kind::CmpLesser;
-			case Token::Type::LesserOrEqual: return AST::BinaryExpr::Kind::CmpLesserOrEqual;
-			case Token::Type::Greater: return AST::BinaryExpr::Kind::CmpGreater;
-			case Token::Type::GreaterOrEqual: return AST::BinaryExpr::Kind::CmpGreaterOrEqual;
-			case Token::Type::Equal: return AST::BinaryExpr::Kind::CmpEqual;
-			case Token::Type::NotEqual: return AST::BinaryExpr::Kind::CmpNotEqual;
-			case Token::Type::And: return AST::BinaryExpr::Kind::CmpAnd;
-			case Token::Type::Or: return AST::BinaryExpr::Kind::CmpOr;
-			case Token::Type::Xor: return AST::BinaryExpr::Kind::CmpXor;
-			case Token::Type::Plus: return AST::BinaryExpr::Kind::Add;
-			case Token::Type::Minus: return AST::BinaryExpr::Kind::Sub;
+AST::NodeId Parser::parse_binary(const AST::NodeId left) {
+	if (!left || !check_binary()) return left;
+
+	// Operator precedence parsing on explicit stacks, so chains of any
+	// length take constant stack. Operands nested in an operand, like the
+	// branches of an if-expression, use the stacks above our base.
+	const std::size_t operand_base = operands.size();
+	const std::size_t operator_base = operators.size();
+
+	const auto reduce = [&]() {
+		const AST::NodeId right = operands.back();
+		operands.pop_back();
+		operands.back() = make_ast(AST::BinaryExpr{
+			.left = operands.back(),
+			.right = right,
+			.kind = operators.back() });
+		operators.pop_back();
+	};
+
+	operands.push_back(left);
+	while (const auto kind = binary_kind(current_token().type)) {
+		next();
+		while (operators.size() > operator_base && precedence(operators.back()) >= precedence(*kind)) {
+			reduce();
 		}
-	}();
-
-	auto expr = parse_expr();
-	if (!expr) {
-		push_error("expected expression in right hand side of binary expression");
-		return nullptr;
+		operators.push_back(*kind);
+
+		const auto right = parse_operand();
+		if (!right) {
+			push_error(DiagId::ExpectedBinaryRhs);
+			operands.resize(operand_base);
+			operators.resize(operator_base);
+			return AST::NoNode;
+		}
+		operands.push_back(right);
 	}
 
-	return make_ast(AST::BinaryExpr{
-		.left = std::move(left),
-		.right = std::move(expr),
-		.kind = kind });
+	while (operators.size() > operator_base) {
+		reduce();
+	}
+	const AST::NodeId expr = operands.back();
+	operands.pop_back();
+	return expr;
 }
 
 AST::Type Parser::parse_type() {
@@ -578,24 +620,26 @@ AST::Type Parser::parse_type() {
 	while (!is_at_end()) {
 		if (check(Token::Type::Star)) {
 			// pointer
-			type.qualifiers.push_back(
-				AST::Type::Qualifier{
-					.kind = AST::Type::Qualifier::Kind::Pointer
-				}
-			);
+			if (!type.add_qualifier(AST::Type::Qualifier{ .kind = AST::Type::Qualifier::Kind::Pointer })) {
+				push_error(DiagId::TooManyQualifiers, std::int64_t{ AST::Type::max_qualifiers });
+				return {};
+			}
 			next();
 		} else if (check(Token::Type::LeftSqBracket)) {
 			// array
 			next();
-			if (!expect(Token::Type::Number, "expected array size")) {
+			if (!expect(Token::Type::Number, DiagId::ExpectedArraySize)) {
 				return {};
 			}
-			int len = std::stoi(next().text);
-			if (!expect(Token::Type::RightSqBracket, "expected ]")) return {};
+			int len = std::stoi(std::string(next().text));
+			if (!expect(Token::Type::RightSqBracket, DiagId::ExpectedArrayClose)) return {};
 			next();
-			type.qualifiers.push_back(AST::Type::Qualifier{
+			if (!type.add_qualifier(AST::Type::Qualifier{
 				.kind = AST::Type::Qualifier::Kind::Array,
-				.array_length = len });
+				.array_length = len })) {
+				push_error(DiagId::TooManyQualifiers, std::int64_t{ AST::Type::max_qualifiers });
+				return {};
+			}
 		} else {
 			break;
 		}
@@ -1,7 +1,7 @@
 #pragma once
 #include "token.hpp"
 #include "ast.hpp"
-#include <span>
+#include <vector>
 
 class Parser {
 private:
@@ -12,52 +12,72 @@ private:
 		Expression
 	};
 public:
-	struct Error {
-		constexpr explicit Error(const std::string& message);
-		std::string message;
-	};
-
-	AST::Ptr parse(const std::vector<Token>& tokens);
-	bool has_errors() const;
-	const std::vector<Error>& get_errors() const;
+	explicit Parser(Diagnostics& diagnostics);
+	// fills root with one tree per function, reusing the trees already in it
+	void parse(Lexer& lexer, AST::Root& root);
 
 private:
-	bool is_at_end() const;
-	const Token& current_token() const;
-	bool check(const Token::Type type) const;
-	bool check_binary() const;
-	bool expect(const Token::Type type, const std::string& error_message);
-	bool expect_data_type(const std::string& error_message);
+	bool is_at_end();
+	const Token& current_token();
+	bool check(const Token::Type type);
+	bool check_binary();
+	bool expect(const Token::Type type, const DiagId error, const DiagArg& arg = {});
+	bool expect_data_type(const DiagId error, const DiagArg& arg = {});
 	Token next();
-	void push_error(const std::string& error_message);
+	void push_error(const DiagId error, const DiagArg& arg = {});
+
+private:
+	template<typename T>
+	AST::NodeId make_ast(const T& val);
+
+	// Collects child nodes on the scratch stack so that only the final
+	// list is copied into the tree. Nested lists stack on top of it.
+	class ListBuilder {
+	public:
+		explicit ListBuilder(Parser& parser) : parser(parser), mark(parser.scratch.size()) {}
+		~ListBuilder() { parser.scratch.resize(mark); }
+		void push(const AST::NodeId node) { parser.scratch.push_back(node); }
+		std::size_t size() const { return parser.scratch.size() - mark; }
+		AST::List finish() const;
+	private:
+		Parser& parser;
+		std::size_t mark;
+	};
 
 private:
-	AST::Ptr parse_top();
-	AST::Ptr parse_stmt();
-	AST::Ptr parse_expr();
+	AST::NodeId parse_top();
+	AST::NodeId parse_stmt();
+	AST::NodeId parse_expr();
 
 private:
-	AST::Ptr parse_tuple(int size_limit = -1);
-	AST::Ptr parse_if(Context context);
-	AST::Ptr parse_while(Context context);
-	AST::Ptr parse_return();
+	AST::NodeId parse_tuple(int size_limit = -1);
+	AST::NodeId parse_if(Context context);
+	AST::NodeId parse_while(Context context);
+	AST::NodeId parse_return();
 
 private:
-	AST::Ptr parse_function();
-	AST::Ptr parse_block();
-	AST::Ptr parse_parameters();
-	AST::Ptr parse_variable(Context context);
+	AST::NodeId parse_function();
+	AST::NodeId parse_block();
+	AST::NodeId parse_parameters();
+	AST::NodeId parse_variable(Context context);
 
 private:
-	AST::Ptr parse_identifier();
-	AST::Ptr parse_number();
-	AST::Ptr parse_binary(AST::Ptr&& left);
+	AST::NodeId parse_identifier();
+	AST::NodeId parse_number();
+	// an operand of a binary operator, which does not continue with one
+	AST::NodeId parse_operand();
+	// left followed by any number of binary operators and their operands
+	AST::NodeId parse_binary(const AST::NodeId left);
 
 private:
 	AST::Type parse_type();
 
 private:
-	std::vector<Token> tokens;
-	size_t index{};
-	std::vector<Error> errors;
-};
\ No newline at end of file
+	Lexer* lexer{};
+	Diagnostics& diagnostics;
+	AST::Tree* tree{};
+	std::vector<AST::NodeId> scratch;
+	// parse_binary's stacks
+	std::vector<AST::NodeId> operands;
+	std::vector<AST::BinaryExpr::Kind> operators;
+};
@@ -0,0 +1,215 @@
+#include "scan.hpp"
+#include <bit>
+
+#ifdef CYREX_X64
+#include <immintrin.h>
+#endif
+
+static const char* skip_scalar(const char* begin, const char* end, const CharClass cls) {
+	while (begin != end && is_char_class(*begin, cls)) {
+		++begin;
+	}
+	return begin;
+}
+
+static const char* find_scalar(const char* begin, const char* end, const char ch) {
+	while (begin != end && *begin != ch) {
+		++begin;
+	}
+	return begin;
+}
+
+#ifdef CYREX_X64
+
+// -- sse2 --
+// sse2 has no byte shuffle, so classes are built from range compares
+
+static __m128i sse2_in_range(const __m128i chunk, const char lo, const char hi) {
+	// (ch - lo) <= (hi - lo) as unsigned bytes
+	const __m128i offset = _mm_sub_epi8(chunk, _mm_set1_epi8(lo));
+	return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(static_cast<char>(hi - lo))), offset);
+}
+
+template <CharClass cls>
+static __m128i sse2_class_mask(const __m128i chunk) {
+	if constexpr (cls == CharClass::Space) {
+		return _mm_or_si128(
+			_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+			sse2_in_range(chunk, '\t', '\r'));
+	} else if constexpr (cls == CharClass::Digit) {
+		return sse2_in_range(chunk, '0', '9');
+	} else if constexpr (cls == CharClass::Identifier) {
+		// setting 0x20 folds upper case onto lower case and nothing else onto a-z
+		const __m128i folded = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+		return _mm_or_si128(
+			sse2_in_range(folded, 'a', 'z'),
+			_mm_cmpeq_epi8(chunk, _mm_set1_epi8('_')));
+	} else {
+		static_assert(cls == CharClass::Punct);
+		// printable and not any of the others
+		const __m128i others = _mm_or_si128(
+			sse2_class_mask<CharClass::Digit>(chunk),
+			sse2_class_mask<CharClass::Identifier>(chunk));
+		return _mm_andnot_si128(others, sse2_in_range(chunk, '!', '~'));
+	}
+}
+
+template <CharClass cls>
+static const char* skip_sse2_class(const char* begin, const char* end) {
+	while (end - begin >= 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+		const unsigned outside = ~_mm_movemask_epi8(sse2_class_mask<cls>(chunk)) & 0xFFFF;
+		if (outside) return begin + std::countr_zero(outside);
+		begin += 16;
+	}
+	return skip_scalar(begin, end, cls);
+}
+
+static const char* skip_sse2(const char* begin, const char* end, const CharClass cls) {
+	switch (cls) {
+		case CharClass::Space: return skip_sse2_class<CharClass::Space>(begin, end);
+		case CharClass::Digit: return skip_sse2_class<CharClass::Digit>(begin, end);
+		case CharClass::Identifier: return skip_sse2_class<CharClass::Identifier>(begin, end);
+		case CharClass::Punct: return skip_sse2_class<CharClass::Punct>(begin, end);
+	}
+	return skip_scalar(begin, end, cls);
+}
+
+static const char* find_sse2(const char* begin, const char* end, const char ch) {
+	const __m128i needle = _mm_set1_epi8(ch);
+	while (end - begin >= 16) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+		const unsigned found = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+		if (found) return begin + std::countr_zero(found);
+		begin += 16;
+	}
+	return find_scalar(begin, end, ch);
+}
+
+// -- avx2 --
+// Classes are looked up with vpshufb: each byte is split into its high and
+// low nibble, each nibble indexes a 16 byte table, and the two results are
+// and-ed. That is only exact for classes that are a union of 'rectangles'
+// of high x low nibbles, so each class owns one bit per rectangle.
+
+enum NibbleBit : std::uint8_t {
+	// ' '
+	SpaceBlank = 1 << 0,
+	// '\t' to '\r'
+	SpaceControl = 1 << 1,
+	Digit = 1 << 2,
+	// 'A' to 'O' and 'a' to 'o'
+	AlphaLow = 1 << 3,
+	// 'P' to 'Z' and 'p' to 'z'
+	AlphaHigh = 1 << 4,
+	Underscore = 1 << 5,
+};
+
+struct NibbleTables {
+	std::array<std::uint8_t, 16> lo{};
+	std::array<std::uint8_t, 16> hi{};
+};
+
+constexpr NibbleTables nibble_tables = []() {
+	NibbleTables t{};
+	const auto rect = [&](std::uint8_t bit, std::initializer_list<int> his, int lo_first, int lo_last) {
+		for (int hi : his) t.hi[hi] |= bit;
+		for (int lo = lo_first; lo <= lo_last; ++lo) t.lo[lo] |= bit;
+	};
+	rect(SpaceBlank, { 0x2 }, 0x0, 0x0);
+	rect(SpaceControl, { 0x0 }, 0x9, 0xD);
+	rect(Digit, { 0x3 }, 0x0, 0x9);
+	rect(AlphaLow, { 0x4, 0x6 }, 0x1, 0xF);
+	rect(AlphaHigh, { 0x5, 0x7 }, 0x0, 0xA);
+	rect(Underscore, { 0x5 }, 0xF, 0xF);
+	return t;
+}();
+
+// punctuation is not a union of few rectangles, so it is not in the tables
+constexpr std::uint8_t nibble_bits(const CharClass cls) {
+	switch (cls) {
+		case CharClass::Space: return SpaceBlank | SpaceControl;
+		case CharClass::Digit: return Digit;
+		case CharClass::Identifier: return AlphaLow | AlphaHigh | Underscore;
+		case CharClass::Punct: return 0;
+	}
+	return 0;
+}
+
+constexpr bool nibble_tables_match_char_classes() {
+	for (const auto cls : { CharClass::Space, CharClass::Digit, CharClass::Identifier }) {
+		for (int ch = 0; ch < 256; ++ch) {
+			const bool in_tables = nibble_tables.lo[ch & 0xF] & nibble_tables.hi[ch >> 4] & nibble_bits(cls);
+			if (in_tables != is_char_class(static_cast<char>(ch), cls)) return false;
+		}
+	}
+	return true;
+}
+
+static_assert(nibble_tables_match_char_classes(), "avx2 nibble tables disagree with char_classes");
+
+CYREX_TARGET_AVX2 static const char* skip_avx2(const char* begin, const char* end, const CharClass cls) {
+	const std::uint8_t bits = nibble_bits(cls);
+	if (bits == 0) return skip_sse2(begin, end, cls);
+
+	// the same 16 byte table in both lanes, as vpshufb does not cross lanes
+	const __m256i lo_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nibble_tables.lo.data())));
+	const __m256i hi_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(nibble_tables.hi.data())));
+	const __m256i nibble_mask = _mm256_set1_epi8(0x0F);
+	const __m256i class_bits = _mm256_set1_epi8(static_cast<char>(bits));
+
+	while (end - begin >= 32) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+		const __m256i lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(chunk, nibble_mask));
+		const __m256i hi = _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble_mask));
+		const __m256i in_class = _mm256_and_si256(_mm256_and_si256(lo, hi), class_bits);
+		// bytes in no rectangle of the class are zero
+		const unsigned outside = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(in_class, _mm256_setzero_si256())));
+		if (outside) return begin + std::countr_zero(outside);
+		begin += 32;
+	}
+	return skip_scalar(begin, end, cls);
+}
+
+CYREX_TARGET_AVX2 static const char* find_avx2(const char* begin, const char* end, const char ch) {
+	const __m256i needle = _mm256_set1_epi8(ch);
+	while (end - begin >= 32) {
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+		const unsigned found = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+		if (found) return begin + std::countr_zero(found);
+		begin += 32;
+	}
+	return find_scalar(begin, end, ch);
+}
+
+#endif
+
+constexpr static Scanner scalar_scanner{ skip_scalar, find_scalar, Isa::Scalar };
+#ifdef CYREX_X64
+constexpr static Scanner sse2_scanner{ skip_sse2, find_sse2, Isa::SSE2 };
+constexpr static Scanner avx2_scanner{ skip_avx2, find_avx2, Isa::AVX2 };
+#endif
+
+const Scanner* Scanner::get(const Isa isa) {
+	switch (isa) {
+		case Isa::Scalar: return &scalar_scanner;
+#ifdef CYREX_X64
+		case Isa::SSE2: return &sse2_scanner;
+		case Isa::AVX2: {
+			static const bool has_avx2 = cpu_has_avx2();
+			return has_avx2 ? &avx2_scanner : nullptr;
+		}
+#endif
+	}
+	return nullptr;
+}
+
+const Scanner& Scanner::best() {
+	static const Scanner& best = []() -> const Scanner& {
+		for (const auto isa : { Isa::AVX2, Isa::SSE2 }) {
+			if (const auto* scanner = get(isa)) return *scanner;
+		}
+		return scalar_scanner;
+	}();
+	return best;
+}
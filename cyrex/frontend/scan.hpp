@@ -0,0 +1,57 @@
+#pragma once
+#include "cpu.hpp"
+#include <array>
+#include <cstdint>
+
+// Character classes used by the lexer.
+// Classification is a table lookup instead of going through the locale.
+enum class CharClass : std::uint8_t {
+	Space = 1 << 0,
+	Digit = 1 << 1,
+	// letters and '_'
+	Identifier = 1 << 2,
+	Punct = 1 << 3,
+};
+
+constexpr std::array<std::uint8_t, 256> char_classes = []() {
+	std::array<std::uint8_t, 256> table{};
+	const auto set = [&](unsigned char ch, CharClass cls) {
+		table[ch] |= static_cast<std::uint8_t>(cls);
+	};
+
+	for (unsigned char ch : { ' ', '\t', '\n', '\v', '\f', '\r' }) {
+		set(ch, CharClass::Space);
+	}
+	for (unsigned char ch = '0'; ch <= '9'; ++ch) {
+		set(ch, CharClass::Digit);
+	}
+	for (unsigned char ch = 'a'; ch <= 'z'; ++ch) {
+		set(ch, CharClass::Identifier);
+		set(ch - 'a' + 'A', CharClass::Identifier);
+	}
+	set('_', CharClass::Identifier);
+	// '_' is punctuation to ispunct, but the lexer always sees it as part of a word
+	for (unsigned char ch = '!'; ch <= '~'; ++ch) {
+		if (!table[ch]) set(ch, CharClass::Punct);
+	}
+	return table;
+}();
+
+constexpr bool is_char_class(const char ch, const CharClass cls) {
+	return char_classes[static_cast<unsigned char>(ch)] & static_cast<std::uint8_t>(cls);
+}
+
+// Skips runs of characters a block at a time.
+// Every implementation gives the same answers, they only differ in speed.
+struct Scanner {
+	// first position in [begin, end) whose character is not in cls
+	const char* (*skip)(const char* begin, const char* end, CharClass cls);
+	// first position in [begin, end) that is ch, or end
+	const char* (*find)(const char* begin, const char* end, char ch);
+	Isa isa;
+
+	// the fastest scanner this cpu supports
+	static const Scanner& best();
+	// nullptr if the isa is not supported by this build or cpu
+	static const Scanner* get(Isa isa);
+};
@@ -1,102 +1,205 @@
 #include "semantics.hpp"
 #include <stdexcept>
 
-void SemanticAnalyzer::analyze(AST::Ptr& ast) {
-	if (ast == nullptr) return;
-
-	if (visited.contains(ast.get())) return;
-	visited.emplace(ast.get());
+SemanticAnalyzer::SemanticAnalyzer(const Interner& interner, Diagnostics& diagnostics) : interner(interner), diagnostics(diagnostics) {
+}
 
-	std::visit([&](auto& x) {
-		using T = std::decay_t<decltype(x)>;
-		if constexpr (std::same_as<T, AST::Top>) {
-			analyze_top(ast, x);
-		} else if constexpr (std::same_as<T, AST::Expr>) {
-			analyze_expr(ast, x);
-		} else if constexpr (std::same_as<T, AST::Stmt>) {
-			analyze_stmt(ast, x);
-		}
-	}, ast->data);
+void SemanticAnalyzer::analyze(AST::Root& root) {
+	for (auto& function : root.functions) {
+		tree = &function;
+		analyze(function.root());
+	}
+	tree = nullptr;
 }
 
-void SemanticAnalyzer::analyze_top(AST::Ptr& ast, AST::Top& top) {
-	std::visit([&](auto& x) {
-		using T = std::decay_t<decltype(x)>;
-		if constexpr (std::same_as<T, AST::Function>) {
+void SemanticAnalyzer::analyze(const AST::NodeId id) {
+	using enum AST::Kind;
+	switch (tree->kind(id)) {
+		case None:
+		return;
+
+		// -- top level --
+		case Function: {
+			auto& x = tree->get<AST::Function>(id);
+			// parameters are in a scope around the body
+			next_slot = 0;
+			slot_constants.clear();
+			symbols.enter_scope();
 			analyze(x.parameter_list);
+			first_local_slot = next_slot;
 			analyze(x.block);
-		} else if constexpr (std::same_as<T, AST::Root>) {
-			for (auto& f : x.functions) {
-				analyze(f);
+			symbols.exit_scope();
+			x.num_slots = next_slot;
+			return;
+		}
+		case ParameterList:
+		analyze_list(tree->get<AST::ParameterList>(id).items);
+		return;
+
+		// -- expressions --
+		case BinaryExpr: {
+			// long chains lean left, walk down the spine instead of recursing
+			const std::size_t spine_base = spine.size();
+			AST::NodeId node = id;
+			while (tree->kind(node) == BinaryExpr) {
+				spine.push_back(node);
+				node = tree->get<AST::BinaryExpr>(node).left;
 			}
-		} else if constexpr (std::same_as<T, AST::ParameterList>) {
-			for (auto& i : x.items) {
-				analyze(i);
+			analyze(node);
+			// innermost first, so constant chains fold completely
+			while (spine.size() > spine_base) {
+				analyze(tree->get<AST::BinaryExpr>(spine.back()).right);
+				fold(spine.back());
+				spine.pop_back();
 			}
+			return;
 		}
-	}, top);
-}
-
-void SemanticAnalyzer::analyze_expr(AST::Ptr& ast, AST::Expr& expr) {
-	std::visit([&](auto& x) {
-		using T = std::decay_t<decltype(x)>;
-		if constexpr (std::same_as<T, AST::BinaryExpr>) {
-			analyze(x.left);
-			analyze(x.right);
-		} else if constexpr (std::same_as<T, AST::IdentifierExpr>) {
-			//sym.is_assignable = var->is_assignable;
-		} else if constexpr (std::same_as<T, AST::LiteralExpr>) {
-			//sym.is_assignable = false;
-		} else if constexpr (std::same_as<T, AST::AssignExpr>) {
-			analyze(x.left);
+		case IdentifierExpr: {
+			auto& sym = tree->get<AST::IdentifierExpr>(id).sym;
+			resolve(sym);
+			// uses of a constant become the constant itself
+			if (sym.slot != AST::NoSlot && slot_constants[sym.slot]) {
+				tree->alias(id, slot_constants[sym.slot]);
+			}
+			return;
+		}
+		case LiteralExpr:
+		return;
+		case AssignExpr: {
+			const auto& x = tree->get<AST::AssignExpr>(id);
+			// the target is resolved but never replaced by its constant
+			if (tree->kind(x.left) == IdentifierExpr) {
+				resolve(tree->get<AST::IdentifierExpr>(x.left).sym);
+			} else {
+				analyze(x.left);
+			}
+			check_assignable(x.left, x.loc);
 			analyze(x.expr);
-		} else if constexpr (std::same_as<T, AST::WhileExpr>) {
+			return;
+		}
+		case WhileExpr: {
+			const auto& x = tree->get<AST::WhileExpr>(id);
 			analyze(x.condition);
 			analyze(x.block);
 			analyze(x.returns);
-		} else if constexpr (std::same_as<T, AST::IfExpr>) {
+			return;
+		}
+		case IfExpr: {
+			const auto& x = tree->get<AST::IfExpr>(id);
 			analyze(x.condition);
 			analyze(x.then_expr);
 			analyze(x.else_expr);
-		} else if constexpr (std::same_as<T, AST::TupleExpr>) {
-			for (auto& item : x.exprs) {
-				analyze(item);
+			if (const auto condition = constant(x.condition)) {
+				tree->alias(id, *condition ? x.then_expr : x.else_expr);
 			}
-		} else if constexpr (std::same_as<T, AST::TupleAssignExpr>) {
+			return;
+		}
+		case TupleExpr:
+		analyze_list(tree->get<AST::TupleExpr>(id).exprs);
+		return;
+		case TupleAssignExpr: {
+			const auto& x = tree->get<AST::TupleAssignExpr>(id);
 			analyze(x.tup_left);
 			analyze(x.tup_right);
+			return;
 		}
-	}, expr);
-}
 
-void SemanticAnalyzer::analyze_stmt(AST::Ptr& ast, AST::Stmt& stmt) {
-	std::visit([&](auto& x) {
-		using T = std::decay_t<decltype(x)>;
-		if constexpr (std::same_as<T, AST::BlockStmt>) {
-			begin_scope();
-			for (auto& stmt : x.statements) {
-				analyze(stmt);
-			}
-			end_scope();
-		} else if constexpr (std::same_as<T, AST::ReturnStmt>) {
-			analyze(x.expr);
-		} else if constexpr (std::same_as<T, AST::VariableStmt>) {
+		// -- statements --
+		case BlockStmt:
+		symbols.enter_scope();
+		analyze_list(tree->get<AST::BlockStmt>(id).statements);
+		symbols.exit_scope();
+		return;
+		case ReturnStmt:
+		analyze(tree->get<AST::ReturnStmt>(id).expr);
+		return;
+		case VariableStmt: {
+			auto& x = tree->get<AST::VariableStmt>(id);
+			// the initializer cannot see the variable it initializes
 			analyze(x.initializer);
-		} else if constexpr (std::same_as<T, AST::WhileStmt>) {
+			declare(x.sym);
+			if (x.is_const && x.sym.slot != AST::NoSlot && constant(x.initializer)) {
+				slot_constants[x.sym.slot] = x.initializer;
+				x.is_folded = true;
+			}
+			return;
+		}
+		case WhileStmt: {
+			const auto& x = tree->get<AST::WhileStmt>(id);
 			analyze(x.condition);
 			analyze(x.block);
-		} else if constexpr (std::same_as<T, AST::IfStmt>) {
+			return;
+		}
+		case IfStmt: {
+			const auto& x = tree->get<AST::IfStmt>(id);
 			analyze(x.condition);
 			analyze(x.then_stmt);
 			analyze(x.else_stmt);
+			return;
 		}
-	}, stmt);
+	}
+	throw std::runtime_error("internal error: unknown AST node kind");
+}
+
+void SemanticAnalyzer::analyze_list(const AST::List& list) {
+	for (const auto item : tree->list(list)) {
+		analyze(item);
+	}
+}
+
+void SemanticAnalyzer::declare(AST::Symbol& sym) {
+	if (symbols.is_bound_in_scope(sym.name)) {
+		diagnostics.report(DiagId::Redefinition, sym.loc, interner.spelling(sym.name));
+		return;
+	}
+	sym.slot = next_slot++;
+	slot_constants.push_back(AST::NoNode);
+	symbols.bind(sym.name, sym);
+}
+
+void SemanticAnalyzer::resolve(AST::Symbol& sym) {
+	const AST::Symbol* decl = symbols.find(sym.name);
+	if (!decl) {
+		diagnostics.report(DiagId::UndefinedSymbol, sym.loc, interner.spelling(sym.name));
+		return;
+	}
+	// IRGen gives parameters no values, so they are neither read nor assigned
+	if (decl->slot < first_local_slot) {
+		diagnostics.report(DiagId::ParameterUse, sym.loc, interner.spelling(sym.name));
+		return;
+	}
+	sym.slot = decl->slot;
+	sym.is_assignable = decl->is_assignable;
+}
+
+void SemanticAnalyzer::check_assignable(const AST::NodeId target, const SourceLoc loc) {
+	if (tree->kind(target) != AST::Kind::IdentifierExpr) {
+		diagnostics.report(DiagId::NotAssignable, loc);
+		return;
+	}
+	const auto& sym = tree->get<AST::IdentifierExpr>(target).sym;
+	// undefined names are already reported
+	if (sym.slot != AST::NoSlot && !sym.is_assignable) {
+		diagnostics.report(DiagId::AssignToConst, sym.loc, interner.spelling(sym.name));
+	}
 }
 
-void SemanticAnalyzer::begin_scope() {
-	scopes.emplace_back();
+std::optional<std::int64_t> SemanticAnalyzer::constant(const AST::NodeId id) const {
+	if (tree->kind(id) != AST::Kind::LiteralExpr) return {};
+	const auto& literal = tree->get<AST::LiteralExpr>(id);
+	if (!literal.type.qualifiers().empty()) return {};
+	if (literal.type.name != "int" && literal.type.name != "long") return {};
+	return literal.number;
 }
 
-void SemanticAnalyzer::end_scope() {
-	scopes.pop_back();
+void SemanticAnalyzer::fold(const AST::NodeId id) {
+	const auto& x = tree->get<AST::BinaryExpr>(id);
+	const auto left = constant(x.left);
+	const auto right = constant(x.right);
+	if (!left || !right) return;
+	// like IRGen, the result has the type of the left operand
+	const AST::LiteralExpr folded{
+		.type = tree->get<AST::LiteralExpr>(x.left).type,
+		.number = fold_binary(x.kind, *left, *right) };
+	tree->replace(id, folded);
 }
@@ -1,27 +1,66 @@
 #pragma once
 #include "ast.hpp"
-#include <unordered_map>
-#include <unordered_set>
+#include "symbol-table.hpp"
 #include <optional>
+#include <cstdint>
+#include <stdexcept>
 
+// value of a binary operator on two constants, wrapping like the target does
+constexpr std::int64_t fold_binary(const AST::BinaryExpr::Kind kind, const std::int64_t a, const std::int64_t b) {
+	using enum AST::BinaryExpr::Kind;
+	const auto ua = static_cast<std::uint64_t>(a);
+	const auto ub = static_cast<std::uint64_t>(b);
+	switch (kind) {
+		case Add: return static_cast<std::int64_t>(ua + ub);
+		case Sub: return static_cast<std::int64_t>(ua - ub);
+		case CmpAnd: return a & b;
+		case CmpOr: return a | b;
+		case CmpXor: return a ^ b;
+		case CmpLesser: return a < b;
+		case CmpLesserOrEqual: return a <= b;
+		case CmpEqual: return a == b;
+		case CmpNotEqual: return a != b;
+		case CmpGreater: return a > b;
+		case CmpGreaterOrEqual: return a >= b;
+	}
+	throw std::runtime_error("internal error: unknown binary operator");
+}
+
+// Resolves every name to its declaration and checks assignments.
+// Parameters have no values yet, so every use of one is reported.
+// Declarations get a slot that is dense within their function, and every
+// use of a name is given the slot of the declaration it refers to.
+// Constant expressions are folded into literals in place, and uses of
+// const variables with a constant initializer are replaced by it.
 class SemanticAnalyzer {
-private:
-	struct Scope {
-		std::unordered_map<std::string, AST::Symbol> syms;
-	};
 public:
-	void analyze(AST::Ptr& ast);
+	SemanticAnalyzer(const Interner& interner, Diagnostics& diagnostics);
+	void analyze(AST::Root& root);
+
+private:
+	void analyze(AST::NodeId id);
+	void analyze_list(const AST::List& list);
 
 private:
-	void analyze_top(AST::Ptr& ast, AST::Top& top);
-	void analyze_expr(AST::Ptr& ast, AST::Expr& expr);
-	void analyze_stmt(AST::Ptr& ast, AST::Stmt& stmt);
+	void declare(AST::Symbol& sym);
+	void resolve(AST::Symbol& sym);
+	// loc is the = of the assignment
+	void check_assignable(const AST::NodeId target, const SourceLoc loc);
 
 private:
-	void begin_scope();
-	void end_scope();
+	std::optional<std::int64_t> constant(const AST::NodeId id) const;
+	void fold(const AST::NodeId id);
 
 private:
-	std::unordered_set<AST*> visited{};
-	std::vector<Scope> scopes;
+	const Interner& interner;
+	Diagnostics& diagnostics;
+	AST::Tree* tree{};
+	SymbolTable<AST::Symbol> symbols;
+	AST::Slot next_slot{};
+	// the parameters of the function have the slots below this one
+	AST::Slot first_local_slot{};
+	// folded initializer of each constant slot of the function, or NoNode
+	std::vector<AST::NodeId> slot_constants;
+	// binary operators whose right operand is still to be analyzed
+	std::vector<AST::NodeId> spine;
 };
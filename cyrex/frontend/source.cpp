@@ -0,0 +1,85 @@
+#include "source.hpp"
+#include <stdexcept>
+#include <format>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+SourceBuffer::SourceBuffer(const std::string& filename) : name(filename) {
+	file_handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		file_handle = nullptr;
+		throw std::runtime_error(std::format("file not found: {}", filename));
+	}
+
+	LARGE_INTEGER file_size{};
+	if (!GetFileSizeEx(file_handle, &file_size)) {
+		CloseHandle(file_handle);
+		throw std::runtime_error(std::format("error reading file: {}", filename));
+	}
+	size = static_cast<std::size_t>(file_size.QuadPart);
+
+	// empty files cannot be mapped
+	if (size == 0) return;
+
+	mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping_handle) {
+		data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (!data) {
+		if (mapping_handle) CloseHandle(mapping_handle);
+		CloseHandle(file_handle);
+		throw std::runtime_error(std::format("error mapping file: {}", filename));
+	}
+}
+
+SourceBuffer::~SourceBuffer() {
+	if (data) UnmapViewOfFile(data);
+	if (mapping_handle) CloseHandle(mapping_handle);
+	if (file_handle) CloseHandle(file_handle);
+}
+
+#else
+
+SourceBuffer::SourceBuffer(const std::string& filename) : name(filename) {
+	const int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error(std::format("file not found: {}", filename));
+	}
+
+	struct stat st{};
+	if (fstat(fd, &st) == -1) {
+		::close(fd);
+		throw std::runtime_error(std::format("error reading file: {}", filename));
+	}
+	size = static_cast<std::size_t>(st.st_size);
+
+	// empty files cannot be mapped
+	if (size != 0) {
+		void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error(std::format("error mapping file: {}", filename));
+		}
+		data = static_cast<const char*>(mapping);
+	}
+
+	// the mapping keeps the file alive
+	::close(fd);
+}
+
+SourceBuffer::~SourceBuffer() {
+	if (data) munmap(const_cast<char*>(data), size);
+}
+
+#endif
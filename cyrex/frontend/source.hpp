@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// A source file mapped read-only into memory.
+// Tokens point straight into the mapping, so it must outlive every
+// token produced from it.
+class SourceBuffer {
+public:
+	explicit SourceBuffer(const std::string& filename);
+	~SourceBuffer();
+
+	SourceBuffer(const SourceBuffer&) = delete;
+	SourceBuffer& operator = (const SourceBuffer&) = delete;
+
+	const std::string& filename() const { return name; }
+	std::string_view text() const { return { data, size }; }
+
+private:
+	std::string name;
+	const char* data{};
+	std::size_t size{};
+#ifdef _WIN32
+	void* file_handle{};
+	void* mapping_handle{};
+#endif
+};
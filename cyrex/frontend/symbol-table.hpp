@@ -0,0 +1,68 @@
+#pragma once
+#include "interner.hpp"
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+// Names visible at the current point of a walk over nested scopes.
+// SymbolIds are dense, so every name has a slot holding its innermost
+// binding. Shadowing a binding saves it in an undo log, and leaving a scope
+// restores what the scope overwrote. Lookup is a single index no matter how
+// deep the nesting, and leaving a scope costs one step per name it bound.
+template <typename T>
+class SymbolTable {
+public:
+	void enter_scope() {
+		scope_starts.push_back(undo_log.size());
+	}
+
+	void exit_scope() {
+		const std::size_t start = scope_starts.back();
+		scope_starts.pop_back();
+		while (undo_log.size() > start) {
+			auto& undo = undo_log.back();
+			slots[undo.name] = undo.previous;
+			undo_log.pop_back();
+		}
+	}
+
+	// binds name in the innermost scope, shadowing outer bindings
+	// returns false if the innermost scope already has one
+	bool bind(const SymbolId name, const T& value) {
+		if (name >= slots.size()) slots.resize(name + 1);
+		auto& slot = slots[name];
+		if (slot && slot->depth == depth()) return false;
+		undo_log.push_back({ name, slot });
+		slot = Binding{ value, depth() };
+		return true;
+	}
+
+	bool is_bound_in_scope(const SymbolId name) const {
+		return name < slots.size() && slots[name] && slots[name]->depth == depth();
+	}
+
+	// the innermost binding of name, or nullptr
+	const T* find(const SymbolId name) const {
+		if (name >= slots.size() || !slots[name]) return nullptr;
+		return &slots[name]->value;
+	}
+
+private:
+	std::uint32_t depth() const { return static_cast<std::uint32_t>(scope_starts.size()); }
+
+	struct Binding {
+		T value;
+		std::uint32_t depth{};
+	};
+
+	struct Undo {
+		SymbolId name;
+		std::optional<Binding> previous;
+	};
+
+private:
+	std::vector<std::optional<Binding>> slots;
+	std::vector<Undo> undo_log;
+	// undo log size when each open scope was entered
+	std::vector<std::size_t> scope_starts;
+};
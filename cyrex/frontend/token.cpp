@@ -1,74 +1,116 @@
 #include "token.hpp"
-#include "util.hpp"
-#include <algorithm>
+#include <iterator>
 
-std::vector<Token> tokenize(
+Lexer::Lexer(
 	const std::string_view str,
-	const std::map<std::string, Token::Type>& keywords,
-	const std::map<std::string, Token::Type>& punctuation
-) {
-	std::vector<Token> tokens;
+	const SpellingTable& keywords,
+	const PunctuationTrie& punctuation,
+	Interner& interner,
+	Diagnostics& diagnostics,
+	const Scanner& scanner,
+	const SourceLoc origin
+) : str(str), start(str.data()), origin(str.data() - origin), keywords(keywords), punctuation(punctuation), interner(interner), diagnostics(diagnostics), scanner(scanner) {
+}
+
+const Token& Lexer::peek(const std::size_t n) {
+	if (n >= max_lookahead) {
+		throw std::runtime_error("internal error: peeked too far ahead");
+	}
+	while (buffered <= n) {
+		lookahead[(head + buffered) % max_lookahead] = lex();
+		++buffered;
+	}
+	return lookahead[(head + n) % max_lookahead];
+}
+
+Token Lexer::next() {
+	const Token token = peek();
+	// the end of the input is never consumed
+	if (token.type != Token::Type::EndOfFile) {
+		head = (head + 1) % max_lookahead;
+		--buffered;
+	}
+	return token;
+}
 
-	auto start = str.begin();
+bool Lexer::is_at_end() {
+	return peek().type == Token::Type::EndOfFile;
+}
 
-	while (start != str.end()) {
-		auto is_digit = [](unsigned char ch) { return isdigit(ch); };
-		auto is_identifier = [](unsigned char ch) { return isalpha(ch) || ch == '_'; };
-		auto is_space = [](unsigned char ch) { return isspace(ch); };
-		auto is_punct = [](unsigned char ch) { return ispunct(ch); };
-		auto is_speech_mark = [](unsigned char ch) { return ch == '\"'; };
+Token Lexer::lex() {
+	const char* const str_end = str.data() + str.size();
+	const auto loc = [&](const char* at) { return static_cast<SourceLoc>(at - origin); };
 
+	while (start != str_end) {
 		// skip whitespace
-		start = std::find_if_not(start, str.end(), is_space);
-		if (start == str.end()) break;
+		start = scanner.skip(start, str_end, CharClass::Space);
+		if (start == str_end) break;
 
 		// scan numbers
-		if (is_digit(*start)) {
-			auto end = std::find_if_not(start, str.end(), is_digit);
-			tokens.emplace_back(std::string{ start, end }, Token::Type::Number);
+		if (is_char_class(*start, CharClass::Digit)) {
+			auto end = scanner.skip(start, str_end, CharClass::Digit);
+			const Token tok{ std::string_view{ start, end }, Token::Type::Number, {}, loc(start) };
 			start = end;
-			continue;
+			return tok;
 		}
 
 		// scan a word
-		if (is_identifier(*start)) {
-			auto end = std::find_if_not(start, str.end(), is_identifier);
-			auto& tok = tokens.emplace_back(std::string{ start,end });
+		if (is_char_class(*start, CharClass::Identifier)) {
+			auto end = scanner.skip(start, str_end, CharClass::Identifier);
+			Token tok{ std::string_view{ start, end } };
+			tok.loc = loc(start);
 			// may be a keyword
-			tok.type = find_or_default(keywords, tok.text, Token::Type::Identifier);
+			tok.type = keywords.find(tok.text).value_or(Token::Type::Identifier);
+			if (tok.type == Token::Type::Identifier) {
+				tok.sym = interner.intern(tok.text);
+			}
 			start = end;
-			continue;
+			return tok;
 		}
 
-		if (is_speech_mark(*start)) {
+		if (*start == '\"') {
+			const char* quote = start;
 			start = std::next(start);
-			auto end = std::find_if(start, str.end(), is_speech_mark);
-			if (end == str.end()) {
-				// unterminated string
-				puts("unterminated string");
+			auto end = scanner.find(start, str_end, '\"');
+			if (end == str_end) {
+				diagnostics.report(DiagId::UnterminatedString, loc(quote));
+				start = str_end;
 				break;
 			}
-			tokens.emplace_back(std::string{ start,end}, Token::Type::String);
+			const Token tok{ std::string_view{ start, end }, Token::Type::String, {}, loc(quote) };
 			start = std::next(end);
-			continue;
+			return tok;
 		}
 
-		if (is_punct(*start)) {
-			std::string best_match;
-			for (auto len = 1; len <= str.end() - start; ++len) {
-				std::string candidate(start, start + len);
-				if (punctuation.contains(candidate)) best_match = candidate;
-			}
-			if (best_match.empty()) goto unexpected;
-			tokens.emplace_back(best_match, punctuation.at(best_match));
-			start += best_match.size();
-			continue;
+		if (is_char_class(*start, CharClass::Punct)) {
+			const auto match = punctuation.match({ start, str_end });
+			if (match.length == 0) goto unexpected;
+			const Token tok{ std::string_view{ start, start + match.length }, match.type, {}, loc(start) };
+			start += match.length;
+			return tok;
 		}
 
 		unexpected:
-		puts("unexpected");
+		diagnostics.report(DiagId::UnexpectedCharacter, loc(start), std::string_view{ start, 1 });
 		start = std::next(start);
-		// errors.push(...)
+	}
+
+	return Token{ std::string_view{ str_end, str_end }, Token::Type::EndOfFile, {}, loc(str_end) };
+}
+
+std::vector<Token> tokenize(
+	const std::string_view str,
+	const SpellingTable& keywords,
+	const PunctuationTrie& punctuation,
+	Interner& interner,
+	Diagnostics& diagnostics,
+	const Scanner& scanner
+) {
+	std::vector<Token> tokens;
+	Lexer lexer(str, keywords, punctuation, interner, diagnostics, scanner);
+
+	while (!lexer.is_at_end()) {
+		tokens.push_back(lexer.next());
 	}
 
 	return tokens;
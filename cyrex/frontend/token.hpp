@@ -1,7 +1,16 @@
 #pragma once
+#include "scan.hpp"
+#include "interner.hpp"
+#include "diagnostics.hpp"
 #include <string>
-#include <map>
+#include <string_view>
 #include <vector>
+#include <array>
+#include <span>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <optional>
 
 struct Token {
 	enum class Type {
@@ -54,13 +63,202 @@ struct Token {
 		GreaterOrEqual,
 		Equal,
 		NotEqual,
+		// -- end of input --
+		EndOfFile,
 	};
-	std::string text;
+	// points into the source buffer
+	std::string_view text;
 	Type type;
+	// set for identifiers
+	SymbolId sym{};
+	SourceLoc loc{};
 };
 
+struct TokenSpelling {
+	std::string_view text;
+	Token::Type type;
+};
+
+// A perfect hash table over a fixed set of spellings, built at compile time.
+// Looking a word up is a length check, a hash and a single compare.
+class SpellingTable {
+public:
+	constexpr static std::size_t capacity_bits = 6;
+	constexpr static std::size_t capacity = std::size_t(1) << capacity_bits;
+
+	constexpr explicit SpellingTable(std::span<const TokenSpelling> spellings) {
+		if (spellings.size() > capacity / 2) {
+			throw std::logic_error("too many spellings for a SpellingTable");
+		}
+
+		min_length = spellings.front().text.size();
+		for (const auto& spelling : spellings) {
+			min_length = std::min(min_length, spelling.text.size());
+			max_length = std::max(max_length, spelling.text.size());
+		}
+
+		// search for a multiplier that puts every spelling in its own slot
+		for (int attempt = 0; !try_seed(spellings); ++attempt) {
+			if (attempt == 100'000) {
+				throw std::logic_error("no perfect hash for these spellings");
+			}
+			seed += 2;
+		}
+	}
+
+	constexpr std::optional<Token::Type> find(const std::string_view text) const {
+		if (text.size() < min_length || text.size() > max_length) {
+			return std::nullopt;
+		}
+		const auto& slot = slots[slot_of(text)];
+		if (slot.text != text) {
+			return std::nullopt;
+		}
+		return slot.type;
+	}
+
+private:
+	constexpr std::size_t slot_of(const std::string_view text) const {
+		const auto byte = [&](std::size_t i) { return static_cast<std::uint32_t>(static_cast<unsigned char>(text[i])); };
+		const std::uint32_t key =
+			byte(0) |
+			byte(text.size() - 1) << 8 |
+			byte(text.size() / 2) << 16 |
+			static_cast<std::uint32_t>(text.size()) << 24;
+		return static_cast<std::uint32_t>(key * seed) >> (32 - capacity_bits);
+	}
+
+	constexpr bool try_seed(std::span<const TokenSpelling> spellings) {
+		slots = {};
+		for (const auto& spelling : spellings) {
+			auto& slot = slots[slot_of(spelling.text)];
+			if (!slot.text.empty()) return false;
+			slot = spelling;
+		}
+		return true;
+	}
+
+private:
+	std::array<TokenSpelling, capacity> slots{};
+	std::uint32_t seed = 0x9E3779B1;
+	std::size_t min_length{};
+	std::size_t max_length{};
+};
+
+// Matches the longest punctuation token at the start of a string.
+// Built at compile time from the punctuation table, matching walks at most
+// one node per character and never allocates.
+class PunctuationTrie {
+public:
+	struct Match {
+		std::size_t length{};
+		Token::Type type{};
+	};
+
+	constexpr explicit PunctuationTrie(std::span<const TokenSpelling> punctuation) {
+		for (const auto& [text, type] : punctuation) {
+			std::size_t node = 0;
+			for (const char c : text) {
+				const auto ch = static_cast<unsigned char>(c);
+				if (ch >= alphabet_size) {
+					throw std::logic_error("punctuation must be ascii");
+				}
+				if (nodes[node].next[ch] == 0) {
+					if (num_nodes == max_nodes) {
+						throw std::logic_error("too much punctuation for a PunctuationTrie");
+					}
+					nodes[node].next[ch] = static_cast<std::uint8_t>(num_nodes++);
+				}
+				node = nodes[node].next[ch];
+			}
+			nodes[node].type = type;
+		}
+	}
+
+	// length is 0 if no punctuation matches
+	constexpr Match match(const std::string_view str) const {
+		Match best{};
+		std::size_t node = 0;
+
+		for (std::size_t i = 0; i < str.size(); ++i) {
+			const auto ch = static_cast<unsigned char>(str[i]);
+			if (ch >= alphabet_size) break;
+			node = nodes[node].next[ch];
+			// no longer punctuation can start with what we have seen
+			if (node == 0) break;
+			if (nodes[node].type) {
+				best = { .length = i + 1, .type = *nodes[node].type };
+			}
+		}
+
+		return best;
+	}
+
+private:
+	// punctuation is ascii, anything above can never match
+	constexpr static std::size_t alphabet_size = 128;
+	constexpr static std::size_t max_nodes = 64;
+
+	struct Node {
+		// 0 is the root, which is never a child, so it doubles as 'no edge'
+		std::array<std::uint8_t, alphabet_size> next{};
+		std::optional<Token::Type> type;
+	};
+
+	std::array<Node, max_nodes> nodes{};
+	std::size_t num_nodes = 1;
+};
+
+// Produces tokens on demand as the parser asks for them,
+// so the source never has to be turned into a token list up front.
+class Lexer {
+public:
+	// the most tokens that can be peeked ahead of the current one
+	constexpr static std::size_t max_lookahead = 4;
+
+	Lexer(
+		const std::string_view str,
+		const SpellingTable& keywords,
+		const PunctuationTrie& punctuation,
+		Interner& interner,
+		Diagnostics& diagnostics,
+		const Scanner& scanner = Scanner::best(),
+		// location of the first character of str, when it is part of a file
+		const SourceLoc origin = 0
+	);
+
+	// the token n places after the current one
+	// past the end of the input this is an EndOfFile token
+	const Token& peek(const std::size_t n = 0);
+	Token next();
+	bool is_at_end();
+
+private:
+	Token lex();
+
+private:
+	std::string_view str;
+	const char* start{};
+	// where location 0 would be
+	const char* origin{};
+	const SpellingTable& keywords;
+	const PunctuationTrie& punctuation;
+	Interner& interner;
+	Diagnostics& diagnostics;
+	const Scanner& scanner;
+
+	// ring buffer of tokens that have been lexed but not consumed
+	std::array<Token, max_lookahead> lookahead{};
+	std::size_t head{};
+	std::size_t buffered{};
+};
+
+// Lexes the whole input at once
 std::vector<Token> tokenize(
 	const std::string_view str,
-	const std::map<std::string, Token::Type>& keywords,
-	const std::map<std::string, Token::Type>& punctuation
+	const SpellingTable& keywords,
+	const PunctuationTrie& punctuation,
+	Interner& interner,
+	Diagnostics& diagnostics,
+	const Scanner& scanner = Scanner::best()
 );
\ No newline at end of file
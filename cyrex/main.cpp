@@ -1,171 +1,84 @@
-#include "frontend/parser.hpp"
+#include "frontend/source.hpp"
+#include "frontend/lexicon.hpp"
+#include "frontend/parse-parallel.hpp"
 #include "frontend/semantics.hpp"
 
 #include "backend/x64.hpp"
 #include "backend/x64-optimizer.hpp"
+#include "backend/ir-passes.hpp"
+#include "backend/ir-binary.hpp"
+#include "backend/ir-text.hpp"
+#include "backend/ir-interpreter.hpp"
 
 #include <iostream>
 #include <iomanip>
 #include <format>
 #include <fstream>
+#include <optional>
+#include <thread>
 
 #include <argparse/argparse.hpp>
 
 using namespace std;
 
-
-// TODO constexpr maps
-
-static const map<string, Token::Type> keywords =
-{
-	// -- keywords --
-	{"function", Token::Type::Function},
-	{"return", Token::Type::Return},
-	{"while", Token::Type::While},
-	{"if", Token::Type::If},
-	{"then", Token::Type::Then},
-	{"else", Token::Type::Else},
-	{"const", Token::Type::Const},
-	{"var", Token::Type::Var},
-	{"inline", Token::Type::Inline},
-	{"do", Token::Type::Do},
-	// types
-	{"void", Token::Type::Void},
-	{"char", Token::Type::Char},
-	{"short", Token::Type::Short},
-	{"int", Token::Type::Int},
-	{"long", Token::Type::Long},
-};
-
-static const map<string, Token::Type> punctuation =
-{
-	// -- punctuation --
-	{"(", Token::Type::LeftParen},
-	{")", Token::Type::RightParen},
-	{"[", Token::Type::LeftSqBracket},
-	{"]", Token::Type::RightSqBracket},
-	{":", Token::Type::Colon},
-	{"{", Token::Type::LeftBrace},
-	{"}", Token::Type::RightBrace},
-	{"=", Token::Type::Assign},
-	{",", Token::Type::Comma},
-	// logic
-	{"&", Token::Type::And},
-	{"|", Token::Type::Or},
-	{"^", Token::Type::Xor},
-	{"!", Token::Type::Not},
-	// arithmetic
-	{"+", Token::Type::Plus},
-	{"-", Token::Type::Minus},
-	{"*", Token::Type::Star},
-	{"/", Token::Type::Slash},
-	// comparison
-	{"<",  Token::Type::Lesser},
-	{">",  Token::Type::Greater},
-	{"<=", Token::Type::LesserOrEqual},
-	{">=", Token::Type::GreaterOrEqual},
-	{"==", Token::Type::Equal},
-	{"!=", Token::Type::NotEqual},
-};
-
-static string tystr(const AST::Type& type) {
-	string s = type.name;
-
-	for (const auto& qual : type.qualifiers) {
-		if (qual.is_const) {
-			s += "const ";
-		}
-
-		if (qual.kind == AST::Type::Qualifier::Kind::Pointer) {
-			s += "*";
-		}
-
-		if (qual.kind == AST::Type::Qualifier::Kind::Array) {
-			s = format("[{} x {}]", s, qual.array_length);
-		}
-
-		s += ' ';
+static void write_ir(const string& filename, const Module& mod) {
+	ofstream outfile(filename);
+	if (!outfile) {
+		throw runtime_error(format("error creating outfile: {}", filename));
 	}
-	return s;
-}
-
-static string v(ValueId id) {
-	return format("v{}", id);
+	print_ir(outfile, mod);
 }
 
-static string read_file(const string& filename) {
-	ifstream infile(filename);
-	if (!infile) {
-		throw runtime_error(format("file not found: {}", filename));
+static void write_binary_ir(const string& filename, const Module& mod) {
+	ofstream outfile(filename, ios::binary);
+	if (!outfile) {
+		throw runtime_error(format("error creating outfile: {}", filename));
 	}
-	string src;
-	ifstream in(filename);
-	getline(in, src, '\0');
-	return src;
+	write_binary_ir(outfile, mod);
 }
 
-static void print_ir_instruction(ostream& outfile, const Inst& ins, const IRGen& irgen) {
-	//outfile << "; ";
-	if (ins.opcode == Opcode::Label) {
-		outfile << format("L{}:", ins.operands[0]) << '\n';
-		return;
+// runs the frontend on a source file, errors are printed and give no module
+static optional<Module> compile_source(const string& filename, Interner& interner, AST::Root& root, const unsigned num_threads) {
+	// tokens point into the source, so it stays mapped until the file is done
+	optional<SourceBuffer> source;
+	try {
+		source.emplace(filename);
+	} catch (const runtime_error& rte) {
+		cerr << rte.what() << '\n';
+		return {};
 	}
 
-	if (ins.opcode == Opcode::Branch) {
-		outfile << format("b v{}, L{}, L{}", ins.operands[0], ins.operands[1], ins.operands[2]) << '\n';
-		return;
-	}
+	Diagnostics diagnostics;
+	parse_parallel(source->text(), keywords, punctuation_trie, interner, diagnostics, root, num_threads);
 
-	if (ins.opcode == Opcode::Jump) {
-		outfile << format("j L{}", ins.operands[0]) << '\n';
-		return;
+	if (diagnostics.has_errors()) {
+		diagnostics.print(cout, *source);
+		return {};
 	}
 
-	// Result + type
-	if (ins.result >= 0) {
-		const auto& val = irgen.get_value_by_id(ins.result);
-		outfile << format("{} : {} = ", v(ins.result), tystr(val.type));
-	}
-	// Opcode
-	outfile << opcode_name(ins.opcode);
-	// Special case: const  print literal value
-	if (ins.opcode == Opcode::Const) {
-		const auto& c = irgen.get_literal_by_id(ins.result);
-		outfile << ' ';
-		visit([&](auto&& x) {
-			outfile << x;
-		}, c.data);
-	}
-	// Operands
-	if (!ins.operands.empty()) {
-		outfile << ' ';
-		for (size_t i = 0; i < ins.operands.size(); ++i) {
-			outfile << v(ins.operands[i]);
-			if (i + 1 < ins.operands.size()) {
-				outfile << ", ";
-			}
-		}
+	SemanticAnalyzer sa{ interner, diagnostics };
+	sa.analyze(root);
+
+	if (diagnostics.has_errors()) {
+		diagnostics.print(cout, *source);
+		return {};
 	}
-	outfile << '\n';
-}
 
-static void print_ir(ostream& os, const IRGen& irgen) {
-	for (const auto& [cfg_name, cfg] : irgen.get_functions()) {
-		for (const auto& blk : cfg.blocks) {
-			os << format("BB{}:\n", blk.lbl_entry);
-			for (const auto& ins : blk.inst) {
-				print_ir_instruction(os, ins, irgen);
-			}
-		}
+	IRGen irgen{ interner };
+	irgen.gen(root);
+	// the module refers to nothing in the trees, so their nodes go now rather
+	// than when the next file is parsed, their memory is kept for that file
+	for (auto& tree : root.functions) {
+		tree.clear();
 	}
-}
 
-static void write_ir(const string& filename, const IRGen& irgen) {
-	ofstream outfile(filename);
-	if (!outfile) {
-		throw runtime_error(format("error creating outfile: {}", filename));
+	if (irgen.has_errors()) {
+		for (const auto& err : irgen.get_errors()) {
+			cout << format("error: {}", err) << '\n';
+		}
+		return {};
 	}
-	print_ir(outfile, irgen);
+	return std::move(irgen.get_module());
 }
 
 static void write_assembly(const string& filename, const X64& x64) {
@@ -190,11 +103,47 @@ int main(int argc, const char* argv[]) {
 		.default_value(false)
 		.implicit_value(true);
 
+	program.add_argument("--binary-ir")
+		.help("output binary IR, which can be compiled again in place of the source")
+		.default_value(false)
+		.implicit_value(true);
+
+	program.add_argument("--from-ir")
+		.help("read the input files as textual IR, as written by --ir")
+		.default_value(false)
+		.implicit_value(true);
+
 	program.add_argument("--optimized")
 		.help("compile with optimization")
 		.default_value(false)
 		.implicit_value(true);
 
+	program.add_argument("--ir-passes")
+		.help("IR pass pipeline, a parenthesized group repeats until nothing changes");
+
+	program.add_argument("--mc-passes")
+		.help("machine code pass pipeline, a parenthesized group repeats until nothing changes");
+
+	program.add_argument("--eval-steps")
+		.help("instructions the optimizer may run to evaluate a function at compile time")
+		.default_value(static_cast<int>(default_eval_steps))
+		.scan<'i', int>();
+
+	program.add_argument("--interpret")
+		.help("run every function with the IR interpreter and print its result instead of compiling")
+		.default_value(false)
+		.implicit_value(true);
+
+	program.add_argument("--time-passes")
+		.help("print the runs, changes and time of every pass")
+		.default_value(false)
+		.implicit_value(true);
+
+	program.add_argument("--jobs")
+		.help("threads to parse with, 0 for one per core")
+		.default_value(0)
+		.scan<'i', int>();
+
 	try {
 		program.parse_args(argc, argv);
 	} catch (const exception& err) {
@@ -204,56 +153,102 @@ int main(int argc, const char* argv[]) {
 	}
 
 	const bool output_ir = program.get<bool>("--ir");
+	const bool output_binary_ir = program.get<bool>("--binary-ir");
+	const bool from_ir = program.get<bool>("--from-ir");
 	const bool is_optimized = program.get<bool>("--optimized");
 	const auto files = program.get<std::vector<std::string>>("input_files");
+	const int jobs = program.get<int>("--jobs");
+	const unsigned num_threads = jobs > 0 ? static_cast<unsigned>(jobs) : max(1u, thread::hardware_concurrency());
+	const bool time_passes = program.get<bool>("--time-passes");
+	const int eval_steps = program.get<int>("--eval-steps");
+	const bool interpret = program.get<bool>("--interpret");
+
+	// passes run on every function of every file, so their statistics add up
+	FunctionPassManager ir_passes;
+	register_ir_passes(ir_passes, static_cast<size_t>(max(eval_steps, 0)));
+	X64Optimizer optimizer;
+	try {
+		ir_passes.set_pipeline(program.is_used("--ir-passes") ? program.get<string>("--ir-passes") : is_optimized ? "mem2reg,fold-constants,evaluate,remove-unreachable" : "");
+		optimizer.passes.set_pipeline(program.is_used("--mc-passes") ? program.get<string>("--mc-passes") : is_optimized ? "(peephole,unused-labels),push-pop" : "push-pop");
+	} catch (const runtime_error& err) {
+		cerr << "fatal: " << err.what() << '\n';
+		return EXIT_FAILURE;
+	}
 
-	for (const auto& filename : files) {
-		if (!filename.ends_with(".cyrex")) {
-			throw runtime_error(format("source file {} must end in .cyrex", filename));
-		}
+	// shared by every file, so names keep their ids across the invocation
+	Interner interner;
+	// holds one file's AST at a time, its memory is reused for the next file
+	AST::Root root;
 
-		vector<Token> tokens;
-		try {
-			tokens = tokenize(read_file(filename), keywords, punctuation);
-		} catch (const runtime_error& rte) {
-			cerr << rte.what() << '\n';
-			return EXIT_FAILURE;
+	for (const auto& filename : files) {
+		// binary and textual IR skip the frontend
+		const bool is_binary_ir = filename.ends_with(".irb");
+		if (!from_ir && !filename.ends_with(".cyrex") && !is_binary_ir) {
+			throw runtime_error(format("source file {} must end in .cyrex or .irb", filename));
 		}
 
-		Parser parser;
-		auto root = parser.parse(tokens);
-
-		if (parser.has_errors()) {
-			for (const auto& err : parser.get_errors()) {
-				cout << format("error: {}", err.message) << '\n';
+		optional<Module> compiled;
+		if (from_ir) {
+			try {
+				const SourceBuffer source(filename);
+				compiled = read_ir(source.text(), filename);
+			} catch (const runtime_error& rte) {
+				cerr << rte.what() << '\n';
+				return EXIT_FAILURE;
+			}
+		} else if (is_binary_ir) {
+			try {
+				compiled = BinaryIRFile(filename).to_module();
+			} catch (const runtime_error& rte) {
+				cerr << rte.what() << '\n';
+				return EXIT_FAILURE;
 			}
+		} else {
+			compiled = compile_source(filename, interner, root, num_threads);
+		}
+		if (!compiled) {
 			return EXIT_FAILURE;
 		}
+		Module& mod = *compiled;
 
-		SemanticAnalyzer sa;
-		sa.analyze(root);
+		const string stem = filename.substr(0, filename.rfind('.'));
+		string assembly_filename = stem + ".asm";
+		string ir_filename = stem + ".ir";
 
-		IRGen irgen;
-		irgen.gen(root);
+		for (auto& [fn_name, fn] : mod.functions) {
+			FunctionAnalyses analyses{ fn };
+			ir_passes.run(fn, analyses);
+		}
 
-		if (irgen.has_errors()) {
-			for (const auto& err : irgen.get_errors()) {
-				cout << format("error: {}", err) << '\n';
+		if (interpret) {
+			IRInterpreter interpreter(static_cast<size_t>(max(eval_steps, 0)));
+			for (const auto& [fn_name, fn] : mod.functions) {
+				const auto evaluation = interpreter.run(fn);
+				switch (evaluation.status) {
+					case Evaluation::Status::Returned:
+					cout << format("{}: {}", fn_name, evaluation.value ? to_string(*evaluation.value) : "no value");
+					break;
+					case Evaluation::Status::OutOfSteps: cout << format("{}: out of steps", fn_name); break;
+					case Evaluation::Status::Undefined: cout << format("{}: reads an undefined value", fn_name); break;
+				}
+				cout << format(" ({} steps)\n", evaluation.steps);
 			}
-			return EXIT_FAILURE;
+			continue;
 		}
 
-		string assembly_filename = filename.substr(0, filename.size() - 6) + ".asm";
-		string ir_filename = filename.substr(0, filename.size() - 6) + ".ir";
-
-		X64Optimizer optimizer{ irgen };
-		optimizer.is_enabled = is_optimized;
-
-		X64 x64(irgen, optimizer);
+		lower_phis(mod);
+		X64 x64(mod, optimizer);
 		x64.module();
 
 		write_assembly(assembly_filename, x64);
-		if (output_ir) write_ir(ir_filename, irgen);
+		// never replace the textual IR being compiled
+		if (output_ir && ir_filename != filename) write_ir(ir_filename, mod);
+		if (output_binary_ir) write_binary_ir(stem + ".irb", mod);
+	}
+
+	if (time_passes) {
+		ir_passes.print_stats(cerr);
+		optimizer.passes.print_stats(cerr);
 	}
 
 	return 0;
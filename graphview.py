@@ -16,7 +16,10 @@ def parse(lines):
 
     for line in lines:
         line = line.strip()
-        if line.startswith("BB"):
+        if line.startswith("function"):
+            current_bb = None
+            continue
+        elif line.startswith("BB"):
             current_bb = line.split(':')[0]
             blocks[current_bb] = make_blank_bb()
             continue